@@ -0,0 +1,168 @@
+// 连接风暴基准: 测量 accept 吞吐, 以及连接数上限和 fd 耗尽时服务端的表现
+// 用法: bench_accept [--json] [--connections N] [--clients N] [--threads N] [--hold N]
+// 服务端在子进程中运行, 每个新连接发送 "ok" 后半关闭; 客户端读到 EOF 后关闭连接
+// storm: 客户端并发地连接-读取-关闭, 统计每秒完成的连接数
+// overload: 同时保持 --hold 个连接, 服务端受连接数上限或 RLIMIT_NOFILE 限制,
+//           统计被服务和被丢弃的连接数, 之后再跑一轮 storm 确认服务端仍然可用
+
+#include "bench_util.h"
+#include "net/tcp_server.h"
+#include "event/event_loop.h"
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/resource.h>
+#include <unistd.h>
+
+namespace {
+
+struct ServerConfig {
+    net::TcpServer::Option option;
+    int threads;
+    int max_connections;
+    int fd_limit;  // 0 表示不修改 RLIMIT_NOFILE
+};
+
+void OnConnection(const net::TcpConnectionPtr &conn) {
+    if (conn->Connected()) {
+        conn->Send(std::string("ok"));
+        conn->Shutdown();
+    }
+}
+
+pid_t StartServer(uint16_t port, const ServerConfig &config) {
+    return bench::StartServer([&]() {
+        if (config.fd_limit > 0) {
+            rlimit limit;
+            limit.rlim_cur = limit.rlim_max = config.fd_limit;
+            setrlimit(RLIMIT_NOFILE, &limit);
+        }
+        event::EventLoop loop;
+        net::TcpServer server(&loop, net::InetAddress(port), "bench", config.option);
+        server.SetConnectionCallback(OnConnection);
+        server.SetThreadNum(config.threads);
+        server.SetMaxConnections(config.max_connections);
+        server.Start();
+        loop.Loop();
+    });
+}
+
+// 读到 EOF, 返回是否收到了 "ok"
+bool ReadUntilEof(int fd) {
+    char buf[16];
+    size_t total = 0;
+    for (;;) {
+        ssize_t n = ::read(fd, buf + total, sizeof(buf) - total);
+        if (n <= 0) break;
+        total += n;
+        if (total == sizeof(buf)) total = 0;
+    }
+    return total >= 2;
+}
+
+void AddRow(bench::Report &report, const char *scenario, const char *mode,
+            size_t connections, double seconds, size_t served, size_t dropped) {
+    report.Add("scenario", scenario)
+          .Add("mode", mode)
+          .Add("connections", connections)
+          .Add("conn_per_sec", connections / seconds, 0)
+          .Add("served", served)
+          .Add("dropped", dropped)
+          .EndRow();
+}
+
+void Storm(bench::Report &report, const char *mode, uint16_t port, size_t connections, int clients) {
+    std::atomic<size_t> next(0);
+    std::atomic<size_t> served(0);
+    std::atomic<size_t> dropped(0);
+    std::vector<std::thread> threads;
+    int64_t start = bench::NowNs();
+    for (int i = 0; i < clients; ++i) {
+        threads.emplace_back([&]() {
+            while (next++ < connections) {
+                int fd = bench::TryConnect(net::InetAddress(port), false);
+                if (fd >= 0 && ReadUntilEof(fd)) {
+                    ++served;
+                } else {
+                    ++dropped;
+                }
+                if (fd >= 0) ::close(fd);
+            }
+        });
+    }
+    for (auto &thread : threads) thread.join();
+    double seconds = (bench::NowNs() - start) / 1e9;
+
+    AddRow(report, "storm", mode, connections, seconds, served, dropped);
+}
+
+// 同时保持 hold 个连接, 全部建立之后再统计被服务的数量, 然后一起关闭
+void Overload(bench::Report &report, const char *scenario, uint16_t port, size_t hold) {
+    std::vector<int> fds;
+    size_t served = 0;
+    size_t dropped = 0;
+    int64_t start = bench::NowNs();
+    for (size_t i = 0; i < hold; ++i) {
+        int fd = bench::TryConnect(net::InetAddress(port), false);
+        if (fd < 0) {
+            ++dropped;
+            continue;
+        }
+        fds.push_back(fd);
+    }
+    for (int fd : fds) {
+        if (ReadUntilEof(fd)) {
+            ++served;
+        } else {
+            ++dropped;
+        }
+    }
+    double seconds = (bench::NowNs() - start) / 1e9;
+    for (int fd : fds) ::close(fd);
+
+    AddRow(report, scenario, "single", hold, seconds, served, dropped);
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    bench::Args args(argc, argv);
+    size_t connections = args.Int("--connections", "N", 20000);
+    int clients = args.Int("--clients", "N", 4);
+    int threads = args.Int("--threads", "N", 2);
+    size_t hold = args.Int("--hold", "N", 200);
+    args.Check();
+
+    // 客户端同时保持 hold 个连接
+    bench::RaiseFdLimit(hold + 64);
+
+    bench::Report report(args.json());
+    ServerConfig single = { net::TcpServer::kNoReusePort, threads, 0, 0 };
+    pid_t pid = StartServer(15090, single);
+    Storm(report, "single", 15090, connections, clients);
+    bench::StopServer(pid);
+
+    ServerConfig per_loop = { net::TcpServer::kReusePortPerLoop, threads, 0, 0 };
+    pid = StartServer(15091, per_loop);
+    Storm(report, "per_loop", 15091, connections, clients);
+    bench::StopServer(pid);
+
+    // 连接数上限为 hold 的一半
+    ServerConfig limited = { net::TcpServer::kNoReusePort, threads, static_cast<int>(hold / 2), 0 };
+    pid = StartServer(15092, limited);
+    Overload(report, "max_connections", 15092, hold);
+    Storm(report, "single", 15092, connections / 10, clients);
+    bench::StopServer(pid);
+
+    // 服务端 fd 上限为 hold 的一半, 触发 EMFILE
+    ServerConfig fd_limited = { net::TcpServer::kNoReusePort, threads, 0, static_cast<int>(hold / 2) };
+    pid = StartServer(15093, fd_limited);
+    Overload(report, "emfile", 15093, hold);
+    Storm(report, "single", 15093, connections / 10, clients);
+    bench::StopServer(pid);
+
+    report.Finish();
+    return 0;
+}
@@ -0,0 +1,99 @@
+// 跨线程任务投递基准: 多个生产者线程向同一个 EventLoop QueueInLoop
+// 用法: bench_dispatch [--json] [--tasks N] [--producers N]
+// burst: 生产者连续投递; pingpong: 每次投递后等待执行完成, 每个任务都需要唤醒
+// 输出吞吐 (tasks/s) 和每个任务平均触发的 eventfd 写次数
+
+#include "bench_util.h"
+#include "event/event_loop.h"
+#include "event/event_loop_thread.h"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// 输出投递 total 个任务的吞吐和每个任务平均的 eventfd 写次数
+void AddRow(bench::Report &report, const char *pattern, int producers, size_t total,
+            int64_t elapsed_ns, uint64_t wakeups) {
+    report.Add("pattern", pattern)
+          .Add("producers", producers)
+          .Add("tasks", total)
+          .Add("tasks_per_sec", total * 1e9 / elapsed_ns, 0)
+          .Add("wakeups_per_task", static_cast<double>(wakeups) / total, 4)
+          .EndRow();
+}
+
+void RunBurst(bench::Report &report, event::EventLoop *loop, int producers, size_t tasks) {
+    std::atomic<size_t> done(0);
+    const size_t per_producer = tasks / producers;
+    const size_t total = per_producer * producers;
+    const uint64_t wakeups = loop->wakeup_count();
+
+    int64_t start = bench::NowNs();
+    std::vector<std::thread> threads;
+    for (int i = 0; i < producers; ++i) {
+        threads.emplace_back([loop, &done, per_producer]() {
+            for (size_t j = 0; j < per_producer; ++j) {
+                loop->QueueInLoop([&done]() { done.fetch_add(1, std::memory_order_relaxed); });
+            }
+        });
+    }
+    for (auto &thread : threads) thread.join();
+    while (done.load(std::memory_order_acquire) < total) {
+        std::this_thread::yield();
+    }
+    int64_t elapsed = bench::NowNs() - start;
+
+    AddRow(report, "burst", producers, total, elapsed, loop->wakeup_count() - wakeups);
+}
+
+void RunPingPong(bench::Report &report, event::EventLoop *loop, int producers, size_t tasks) {
+    const size_t per_producer = tasks / producers;
+    const size_t total = per_producer * producers;
+    const uint64_t wakeups = loop->wakeup_count();
+
+    int64_t start = bench::NowNs();
+    std::vector<std::thread> threads;
+    for (int i = 0; i < producers; ++i) {
+        threads.emplace_back([loop, per_producer]() {
+            std::atomic_bool finished(false);
+            for (size_t j = 0; j < per_producer; ++j) {
+                finished.store(false, std::memory_order_relaxed);
+                loop->QueueInLoop([&finished]() { finished.store(true, std::memory_order_release); });
+                while (!finished.load(std::memory_order_acquire)) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (auto &thread : threads) thread.join();
+    int64_t elapsed = bench::NowNs() - start;
+
+    AddRow(report, "pingpong", producers, total, elapsed, loop->wakeup_count() - wakeups);
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    int default_producers = static_cast<int>(std::thread::hardware_concurrency()) - 1;
+    bench::Args args(argc, argv);
+    size_t tasks = args.Int("--tasks", "N", 1 << 20);
+    int producers = args.Int("--producers", "N", std::max(default_producers, 1));
+    args.Check();
+
+    event::EventLoopThread loop_thread;
+    event::EventLoop *loop = loop_thread.StartLoop();
+
+    bench::Report report(args.json());
+    std::vector<int> producer_counts = { 1 };
+    if (producers > 1) producer_counts.push_back(producers);
+    for (int n : producer_counts) {
+        RunBurst(report, loop, n, tasks);
+        // pingpong 每个任务一次往返, 任务数减少以控制运行时间
+        RunPingPong(report, loop, n, tasks / 16);
+    }
+    report.Finish();
+    return 0;
+}
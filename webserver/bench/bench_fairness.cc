@@ -0,0 +1,166 @@
+// 公平性基准: 同一个 IO 线程上, 少量连接发送长串流水线的重请求, 其他连接发送一问一答的轻请求
+// 比较不限制和按连接每轮预算两种情况下轻请求的延迟分布 (p50/p99/max) 以及重请求的吞吐
+// 用法: bench_fairness [--json] [--seconds S] [--batch N] [--bulk N] [--small N] [--work N] [--interval US]
+// 协议按行: "w\n" 在服务端做 --work 轮计算后回复 "ok\n", "p\n" 立即回复 "ok\n"
+// 轻请求每隔 --interval 微秒发一个, 样本在时间上均匀分布, 才能反映被重请求阻塞的时间比例
+// 服务端在子进程中运行, 只有一个 IO 线程
+
+#include "bench_util.h"
+#include "net/tcp_server.h"
+#include "event/event_loop.h"
+
+#include <atomic>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+struct ServerConfig {
+    const char *mode;
+    bool edge_triggered;
+    size_t budget_bytes;
+    int budget_requests;
+};
+
+int g_work = 2000;
+// 保存计算结果, 防止 DoWork 被优化掉
+volatile uint32_t g_sink;
+
+// 模拟请求处理的计算量
+uint32_t DoWork(int rounds) {
+    uint32_t hash = 2166136261u;
+    for (int i = 0; i < rounds; ++i) {
+        hash = (hash ^ static_cast<uint32_t>(i)) * 16777619u;
+    }
+    return hash;
+}
+
+// 回复都很小, 关闭 Nagle, 否则重请求的吞吐受延迟确认限制
+void OnConnection(const net::TcpConnectionPtr &conn) {
+    if (conn->Connected()) {
+        int one = 1;
+        ::setsockopt(conn->fd(), IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+}
+
+void OnMessage(const net::TcpConnectionPtr &conn, net::Buffer *buf) {
+    while (!conn->reading_paused()) {
+        const char *eol = static_cast<const char*>(memchr(buf->Peek(), '\n', buf->ReadableBytes()));
+        if (eol == nullptr) return;
+        if (!conn->ConsumeRequestBudget()) return;
+        char op = *buf->Peek();
+        buf->RetrieveUntil(eol + 1);
+        if (op == 'w') g_sink = DoWork(g_work);
+        conn->Send(std::string("ok\n"));
+    }
+}
+
+pid_t StartServer(uint16_t port, const ServerConfig &config) {
+    return bench::StartServer([&]() {
+        event::EventLoop loop;
+        net::TcpServer server(&loop, net::InetAddress(port), "bench");
+        server.SetConnectionCallback(OnConnection);
+        server.SetMessageCallback(OnMessage);
+        server.SetThreadNum(1);
+        server.SetEdgeTriggered(config.edge_triggered);
+        server.SetIoBudget(config.budget_bytes, config.budget_requests);
+        server.Start();
+        loop.Loop();
+    });
+}
+
+// 每个回复 3 字节, 读到 count 个回复为止, 连接断开返回 false
+bool ReadReplies(int fd, size_t count) {
+    return bench::ReadFull(fd, count * 3);
+}
+
+void Run(bench::Report &report, const ServerConfig &config, uint16_t port, double seconds,
+         int batch, int bulk_clients, int small_clients, int interval_us) {
+    pid_t pid = StartServer(port, config);
+    std::atomic<bool> stop(false);
+    std::atomic<size_t> bulk_done(0);
+    std::vector<std::vector<int64_t>> latencies(small_clients);
+    std::vector<std::thread> threads;
+
+    std::string bulk_request;
+    for (int i = 0; i < batch; ++i) bulk_request += "w\n";
+
+    for (int i = 0; i < bulk_clients; ++i) {
+        threads.emplace_back([&]() {
+            int fd = bench::Connect(net::InetAddress(port));
+            while (!stop) {
+                if (::write(fd, bulk_request.data(), bulk_request.size()) < 0) break;
+                if (!ReadReplies(fd, batch)) break;
+                bulk_done += batch;
+            }
+            ::close(fd);
+        });
+    }
+    // 先让重请求把 loop 占满
+    usleep(100 * 1000);
+    for (int i = 0; i < small_clients; ++i) {
+        std::vector<int64_t> *samples = &latencies[i];
+        threads.emplace_back([&, samples]() {
+            int fd = bench::Connect(net::InetAddress(port));
+            while (!stop) {
+                int64_t start = bench::NowNs();
+                if (::write(fd, "p\n", 2) < 0 || !ReadReplies(fd, 1)) break;
+                samples->push_back(bench::NowNs() - start);
+                if (interval_us > 0) usleep(interval_us);
+            }
+            ::close(fd);
+        });
+    }
+
+    size_t bulk_start = bulk_done;
+    int64_t start = bench::NowNs();
+    usleep(static_cast<useconds_t>(seconds * 1000000));
+    double elapsed = (bench::NowNs() - start) / 1e9;
+    size_t bulk = bulk_done - bulk_start;
+    stop = true;
+    // 服务端先退出, 阻塞在 read 上的客户端读到 EOF 后退出
+    bench::StopServer(pid);
+    for (auto &thread : threads) thread.join();
+
+    std::vector<int64_t> all = bench::Merge(latencies);
+    report.Add("mode", config.mode)
+          .Add("small_requests", all.size())
+          .Add("small_p50_us", bench::Percentile(all, 0.5), 1)
+          .Add("small_p99_us", bench::Percentile(all, 0.99), 1)
+          .Add("small_max_us", bench::Percentile(all, 1), 1)
+          .Add("bulk_per_sec", bulk / elapsed, 0)
+          .EndRow();
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    bench::Args args(argc, argv);
+    double seconds = args.Double("--seconds", "S", 2);
+    int batch = args.Int("--batch", "N", 512);
+    int bulk_clients = args.Int("--bulk", "N", 2);
+    int small_clients = args.Int("--small", "N", 2);
+    g_work = args.Int("--work", "N", g_work);
+    int interval_us = args.Int("--interval", "US", 200);
+    args.Check();
+
+    ServerConfig configs[] = {
+        { "unlimited_lt", false, 0, 0 },
+        { "budget_lt", false, net::TcpConnection::kDefaultBudgetBytes, net::TcpConnection::kDefaultBudgetRequests },
+        { "unlimited_et", true, 0, 0 },
+        { "budget_et", true, net::TcpConnection::kDefaultBudgetBytes, net::TcpConnection::kDefaultBudgetRequests },
+    };
+    bench::Report report(args.json());
+    uint16_t port = 15100;
+    for (const ServerConfig &config : configs) {
+        Run(report, config, port++, seconds, batch, bulk_clients, small_clients, interval_us);
+    }
+    report.Finish();
+    return 0;
+}
@@ -0,0 +1,119 @@
+// 空闲连接基准: 服务端保持大量空闲长连接, 统计空闲期间服务端消耗的 CPU 时间
+// 用法: bench_idle [--json] [--connections N] [--seconds S]
+// 客户端建立 --connections 个连接后不再发送任何数据, 连接数超过 RLIMIT_NOFILE 允许的范围时自动减少
+// 服务端在子进程中只有一个 loop, 上面运行多个监听不同端口的 TcpServer, 每个端口最多 kPerPort 个连接,
+// 避免用完回环上同一目的端口的临时端口
+// no_timeout:   连接没有超时
+// idle_timeout: 每个连接在时间轮上挂一个空闲超时 (远长于测试时间), 空闲期间只有时间轮的 tick
+// setup_cpu_ms 是建立连接阶段服务端的 CPU 时间, idle_cpu_ms 是之后 --seconds 秒内的 CPU 时间 (两者从 /proc 读取),
+// total_cpu_ms 是杀死服务端后 wait4 得到的总 CPU 时间, 包含进程退出时内核关闭所有连接的开销
+// 空闲开销应当与连接数无关: 可以和 --connections 100 的结果对比
+
+#include "bench_util.h"
+#include "net/tcp_server.h"
+#include "event/event_loop.h"
+
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+namespace {
+
+const size_t kPerPort = 20000;
+// 除连接之外, 每个进程预留的 fd 数
+const size_t kReservedFds = 64;
+
+pid_t StartServer(uint16_t port, size_t ports, double idle_timeout) {
+    return bench::StartServer([=]() {
+        event::EventLoop loop;
+        std::vector<std::unique_ptr<net::TcpServer>> servers;
+        for (size_t i = 0; i < ports; ++i) {
+            net::InetAddress addr(static_cast<uint16_t>(port + i));
+            servers.emplace_back(new net::TcpServer(&loop, addr, "bench"));
+            servers.back()->SetIdleTimeout(idle_timeout);
+            servers.back()->Start();
+        }
+        loop.Loop();
+    });
+}
+
+// 从 /proc 读取进程到目前为止的 CPU 时间, 单位毫秒
+double ProcessCpuMs(pid_t pid) {
+    std::string path = "/proc/" + std::to_string(pid) + "/stat";
+    FILE *fp = fopen(path.c_str(), "r");
+    if (fp == nullptr) return 0;
+    char buf[1024];
+    size_t n = fread(buf, 1, sizeof(buf) - 1, fp);
+    fclose(fp);
+    buf[n] = '\0';
+    // 进程名可能含空格, 从最后一个 ')' 之后开始数: state 是第 3 个字段, utime/stime 是第 14/15 个
+    const char *p = strrchr(buf, ')');
+    if (p == nullptr) return 0;
+    unsigned long utime = 0, stime = 0;
+    if (sscanf(p + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu", &utime, &stime) != 2) return 0;
+    return (utime + stime) * 1000.0 / sysconf(_SC_CLK_TCK);
+}
+
+void Run(bench::Report &report, const char *mode, uint16_t port,
+         size_t connections, double seconds, double idle_timeout) {
+    size_t ports = (connections + kPerPort - 1) / kPerPort;
+    pid_t pid = StartServer(port, ports, idle_timeout);
+
+    std::vector<int> fds;
+    fds.reserve(connections);
+    int64_t start = bench::NowNs();
+    for (size_t i = 0; i < connections; ++i) {
+        int fd = bench::TryConnect(net::InetAddress(static_cast<uint16_t>(port + i / kPerPort)));
+        if (fd < 0) {
+            perror("connect");
+            break;
+        }
+        fds.push_back(fd);
+    }
+    double connect_seconds = (bench::NowNs() - start) / 1e9;
+    // 等服务端处理完最后一批连接再开始计时
+    usleep(500 * 1000);
+
+    double setup_cpu_ms = ProcessCpuMs(pid);
+    int64_t idle_start = bench::NowNs();
+    usleep(static_cast<useconds_t>(seconds * 1000000));
+    double idle_seconds = (bench::NowNs() - idle_start) / 1e9;
+    double idle_cpu_ms = ProcessCpuMs(pid) - setup_cpu_ms;
+    double total_cpu_ms = bench::StopServer(pid);
+    for (int fd : fds) ::close(fd);
+
+    report.Add("mode", mode)
+          .Add("connections", fds.size())
+          .Add("connect_seconds", connect_seconds, 2)
+          .Add("setup_cpu_ms", setup_cpu_ms, 0)
+          .Add("idle_seconds", idle_seconds, 1)
+          .Add("idle_cpu_ms", idle_cpu_ms, 0)
+          .Add("total_cpu_ms", total_cpu_ms, 0)
+          .EndRow();
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    bench::Args args(argc, argv);
+    size_t connections = args.Int("--connections", "N", 100000);
+    double seconds = args.Double("--seconds", "S", 5);
+    args.Check();
+
+    // 客户端和服务端各自需要 connections 个 fd, 服务端继承这里的上限
+    size_t limit = bench::RaiseFdLimit(connections + kReservedFds);
+    if (limit < connections + kReservedFds) {
+        connections = limit > kReservedFds ? limit - kReservedFds : 0;
+        fprintf(stderr, "RLIMIT_NOFILE = %zu, connections reduced to %zu\n", limit, connections);
+    }
+
+    // 两轮使用不同的端口, 避免上一轮服务端 TIME_WAIT 的连接影响下一轮
+    bench::Report report(args.json());
+    Run(report, "no_timeout", 15140, connections, seconds, 0);
+    Run(report, "idle_timeout", 15150, connections, seconds, 3600);
+    report.Finish();
+    return 0;
+}
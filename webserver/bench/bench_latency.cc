@@ -0,0 +1,123 @@
+// 回环请求延迟基准: 对比阻塞等待和忙轮询两种 EventLoop 模式
+// 用法: bench_latency [--json] [--requests N] [--connections N] [--busy-poll-us N]
+// 每个连接上串行发送 keep-alive 请求, 统计往返延迟分位数和整个进程消耗的 CPU 时间
+
+#include "bench_util.h"
+#include "http/http_server.h"
+#include "event/event_loop.h"
+#include "event/event_loop_thread.h"
+#include "log/logger.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/resource.h>
+#include <unistd.h>
+
+namespace {
+
+const char kRequest[] = "GET /ping HTTP/1.1\r\nHost: localhost\r\n\r\n";
+const size_t kWarmup = 1000;
+
+int64_t CpuUs() {
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000LL
+           + usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+}
+
+void PingCallback(const http::HttpRequestParser &req, http::HttpResponse &resp, const std::string &web_root) {
+    resp.SetStatusCode(http::HttpResponse::k200Ok);
+    resp.SetStatusMessage("OK");
+    resp.SetCloseConnection(false);
+    resp.AddHeader("Content-Type", "text/plain");
+    resp.SetBody("pong", 4);
+}
+
+// 读完一个响应: 响应头 + Content-Length 字节的响应体
+bool ReadResponse(int fd, std::string &buf) {
+    for (;;) {
+        size_t header_end = buf.find("\r\n\r\n");
+        if (header_end != std::string::npos) {
+            size_t pos = buf.find("Content-Length: ");
+            size_t length = pos < header_end ? strtoul(buf.c_str() + pos + 16, nullptr, 10) : 0;
+            if (buf.size() >= header_end + 4 + length) {
+                buf.erase(0, header_end + 4 + length);
+                return true;
+            }
+        }
+        char data[4096];
+        ssize_t n = ::read(fd, data, sizeof(data));
+        if (n <= 0) return false;
+        buf.append(data, n);
+    }
+}
+
+void RunClient(uint16_t port, size_t requests, std::vector<int64_t> *latencies) {
+    int fd = bench::Connect(net::InetAddress(port));
+    std::string buf;
+    latencies->reserve(requests);
+    for (size_t i = 0; i < kWarmup + requests; ++i) {
+        int64_t start = bench::NowNs();
+        if (::write(fd, kRequest, sizeof(kRequest) - 1) != sizeof(kRequest) - 1 || !ReadResponse(fd, buf)) {
+            fprintf(stderr, "request failed\n");
+            exit(1);
+        }
+        if (i >= kWarmup) latencies->push_back(bench::NowNs() - start);
+    }
+    ::close(fd);
+}
+
+void Run(bench::Report &report, const char *mode, uint16_t port,
+         int busy_poll_us, int connections, size_t requests) {
+    // server 故意不析构: 它只能在自己的 loop 线程中销毁, 基准进程结束时直接退出
+    event::EventLoopThread *loop_thread = new event::EventLoopThread();
+    event::EventLoop *loop = loop_thread->StartLoop();
+    http::HttpServer *server = new http::HttpServer(loop, net::InetAddress(port));
+    server->SetHttpCallback(PingCallback);
+    server->SetMaxKeepAliveRequests(0);
+    server->SetThreadNum(1);
+    server->SetBusyPoll(busy_poll_us);
+    server->Start();
+    usleep(100 * 1000);
+
+    std::vector<std::vector<int64_t>> latencies(connections);
+    std::vector<std::thread> clients;
+    int64_t cpu_start = CpuUs();
+    for (int i = 0; i < connections; ++i) {
+        clients.emplace_back(RunClient, port, requests, &latencies[i]);
+    }
+    for (auto &client : clients) client.join();
+    int64_t cpu = CpuUs() - cpu_start;
+
+    std::vector<int64_t> all = bench::Merge(latencies);
+    report.Add("mode", mode)
+          .Add("connections", connections)
+          .Add("requests", all.size())
+          .Add("p50_us", bench::Percentile(all, 0.5), 1)
+          .Add("p99_us", bench::Percentile(all, 0.99), 1)
+          .Add("p999_us", bench::Percentile(all, 0.999), 1)
+          .Add("cpu_us_per_request", static_cast<double>(cpu) / all.size(), 2)
+          .EndRow();
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    bench::Args args(argc, argv);
+    size_t requests = args.Int("--requests", "N", 20000);
+    int connections = args.Int("--connections", "N", 1);
+    int busy_poll_us = args.Int("--busy-poll-us", "N", 200);
+    args.Check();
+
+    logging::Logger::SetLogFileName("/dev/null");
+
+    bench::Report report(args.json());
+    Run(report, "blocking", 15080, 0, connections, requests);
+    Run(report, "busy_poll", 15081, busy_poll_us, connections, requests);
+    report.Finish();
+    _exit(0);
+}
@@ -0,0 +1,246 @@
+// 内存分配器微基准: 对比 memory::MemoryPool、glibc malloc 和 memory::Arena
+// 用法: bench_memory [--json] [--ops N] [--threads N]
+// 每行输出一个结果, 默认 CSV, 便于和历史结果对比回归
+
+#include "bench_util.h"
+#include "memory/memory_pool.h"
+#include "memory/arena.h"
+#include "cache/lfu_cache.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+#include <sys/resource.h>
+#include <unistd.h>
+
+namespace {
+
+struct Allocator {
+    const char *name;
+    void* (*allocate)(size_t size);
+    void (*deallocate)(size_t size, void *p);
+    // 能否单独释放一个对象, 包括在别的线程上释放; 不能时跳过 random 和 cross_thread
+    bool individual_free;
+};
+
+void* PoolAllocate(size_t size) { return memory::UseMemory(size); }
+void PoolDeallocate(size_t size, void *p) { memory::FreeMemory(size, p); }
+
+void* MallocAllocate(size_t size) { return malloc(size); }
+void MallocDeallocate(size_t size, void *p) { free(p); }
+
+// Arena 没有单独释放, 每轮结束后整体 Reset
+thread_local memory::Arena t_arena(64 * 1024);
+void* ArenaAllocate(size_t size) { return t_arena.Allocate(size); }
+void ArenaDeallocate(size_t size, void *p) {}
+
+const Allocator kAllocators[] = {
+    { "pool", PoolAllocate, PoolDeallocate, true },
+    { "malloc", MallocAllocate, MallocDeallocate, true },
+    { "arena", ArenaAllocate, ArenaDeallocate, false },
+};
+
+const size_t kBatch = 1024;
+
+long CurrentRssKb() {
+    long pages = 0, resident = 0;
+    FILE *fp = fopen("/proc/self/statm", "r");
+    if (fp) {
+        if (fscanf(fp, "%ld %ld", &pages, &resident) != 2) resident = 0;
+        fclose(fp);
+    }
+    return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+long MaxRssKb() {
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+void Touch(void *p, size_t size) {
+    // 只写首字节, 避免测量被 memset 主导
+    static_cast<volatile char*>(p)[0] = static_cast<char>(size);
+}
+
+// 按批分配后逆序释放
+void RunLifo(const Allocator &alloc, const std::vector<size_t> &sizes, size_t ops) {
+    std::vector<void*> ptrs(kBatch);
+    for (size_t done = 0; done < ops; done += kBatch) {
+        for (size_t i = 0; i < kBatch; ++i) {
+            ptrs[i] = alloc.allocate(sizes[(done + i) % sizes.size()]);
+            Touch(ptrs[i], sizes[(done + i) % sizes.size()]);
+        }
+        for (size_t i = kBatch; i-- > 0;) {
+            alloc.deallocate(sizes[(done + i) % sizes.size()], ptrs[i]);
+        }
+        t_arena.Reset();
+    }
+}
+
+// 按批分配后按分配顺序释放
+void RunFifo(const Allocator &alloc, const std::vector<size_t> &sizes, size_t ops) {
+    std::vector<void*> ptrs(kBatch);
+    for (size_t done = 0; done < ops; done += kBatch) {
+        for (size_t i = 0; i < kBatch; ++i) {
+            ptrs[i] = alloc.allocate(sizes[(done + i) % sizes.size()]);
+            Touch(ptrs[i], sizes[(done + i) % sizes.size()]);
+        }
+        for (size_t i = 0; i < kBatch; ++i) {
+            alloc.deallocate(sizes[(done + i) % sizes.size()], ptrs[i]);
+        }
+        t_arena.Reset();
+    }
+}
+
+// 维持固定数量的存活对象, 随机替换, 模拟缓存节点的生命周期
+void RunRandom(const Allocator &alloc, const std::vector<size_t> &sizes, size_t ops) {
+    std::vector<void*> ptrs(kBatch, nullptr);
+    std::vector<size_t> live_sizes(kBatch, 0);
+    std::mt19937 gen(7);
+    for (size_t i = 0; i < ops; ++i) {
+        size_t slot = gen() % kBatch;
+        if (ptrs[slot]) alloc.deallocate(live_sizes[slot], ptrs[slot]);
+        live_sizes[slot] = sizes[i % sizes.size()];
+        ptrs[slot] = alloc.allocate(live_sizes[slot]);
+        Touch(ptrs[slot], live_sizes[slot]);
+    }
+    for (size_t i = 0; i < kBatch; ++i) {
+        if (ptrs[i]) alloc.deallocate(live_sizes[i], ptrs[i]);
+    }
+}
+
+using PatternFunc = void (*)(const Allocator&, const std::vector<size_t>&, size_t);
+
+double RunThreads(const Allocator &alloc, PatternFunc func,
+                  const std::vector<size_t> &sizes, size_t ops, int threads) {
+    std::vector<std::thread> workers;
+    int64_t start = bench::NowNs();
+    for (int i = 0; i < threads; ++i) {
+        workers.emplace_back([&] { func(alloc, sizes, ops); });
+    }
+    for (auto &worker : workers) worker.join();
+    return static_cast<double>(bench::NowNs() - start) / (ops * threads);
+}
+
+// 一个线程分配, 另一个线程释放, 模拟 I/O 线程之间传递对象
+double RunCrossThread(const Allocator &alloc, const std::vector<size_t> &sizes, size_t ops) {
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::vector<std::vector<void*>> batches;
+    bool done = false;
+
+    int64_t start = bench::NowNs();
+    std::thread consumer([&] {
+        size_t freed = 0;
+        while (true) {
+            std::vector<std::vector<void*>> local;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                cond.wait(lock, [&] { return done || !batches.empty(); });
+                if (batches.empty() && done) break;
+                local.swap(batches);
+            }
+            for (auto &batch : local) {
+                for (void *p : batch) {
+                    alloc.deallocate(sizes[freed++ % sizes.size()], p);
+                }
+            }
+        }
+    });
+
+    for (size_t produced = 0; produced < ops; produced += kBatch) {
+        std::vector<void*> batch(kBatch);
+        for (size_t i = 0; i < kBatch; ++i) {
+            size_t size = sizes[(produced + i) % sizes.size()];
+            batch[i] = alloc.allocate(size);
+            Touch(batch[i], size);
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        batches.push_back(std::move(batch));
+        cond.notify_one();
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        done = true;
+        cond.notify_one();
+    }
+    consumer.join();
+    return static_cast<double>(bench::NowNs() - start) / ops;
+}
+
+// 输出一行结果, 附带当前 RSS 和峰值 RSS; size 为 0 表示混合大小
+void AddRow(bench::Report &report, const char *allocator, const char *pattern,
+            int threads, size_t size, size_t ops, double ns_per_op) {
+    report.Add("allocator", allocator)
+          .Add("pattern", pattern)
+          .Add("threads", threads)
+          .Add("size", size)
+          .Add("ops", ops)
+          .Add("ns_per_op", ns_per_op, 2)
+          .Add("rss_kb", CurrentRssKb())
+          .Add("max_rss_kb", MaxRssKb())
+          .EndRow();
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    int default_threads = static_cast<int>(std::thread::hardware_concurrency());
+    bench::Args args(argc, argv);
+    size_t ops = args.Int("--ops", "N", 1 << 21);
+    int threads = args.Int("--threads", "N", std::max(default_threads, 2));
+    args.Check();
+    ops = (ops + kBatch - 1) / kBatch * kBatch;
+
+    memory::InitMemoryPool();
+
+    // LFU 缓存节点大小, 以及二者交替的混合分布
+    const size_t key_node = sizeof(cache::KeyNode);
+    const size_t freq_node = sizeof(cache::FreqNode);
+    struct SizeSet {
+        const char *name;
+        std::vector<size_t> sizes;
+    };
+    std::vector<SizeSet> size_sets = {
+        { "keynode", { key_node } },
+        { "freqnode", { freq_node } },
+        { "mixed", { key_node, freq_node, key_node, 24, 200, 1024, key_node, 4096 } },
+    };
+
+    struct Pattern {
+        const char *name;
+        PatternFunc func;
+    };
+    const Pattern patterns[] = {
+        { "lifo", RunLifo },
+        { "fifo", RunFifo },
+        { "random", RunRandom },
+    };
+
+    bench::Report report(args.json());
+    for (const Allocator &alloc : kAllocators) {
+        for (const SizeSet &set : size_sets) {
+            size_t size = set.sizes.size() == 1 ? set.sizes[0] : 0;
+            for (const Pattern &pattern : patterns) {
+                if (pattern.func == RunRandom && !alloc.individual_free) continue;
+                double ns_per_op = RunThreads(alloc, pattern.func, set.sizes, ops, 1);
+                AddRow(report, alloc.name, pattern.name, 1, size, ops, ns_per_op);
+                ns_per_op = RunThreads(alloc, pattern.func, set.sizes, ops, threads);
+                AddRow(report, alloc.name, pattern.name, threads, size, ops, ns_per_op);
+            }
+
+            if (alloc.individual_free) {
+                double ns_per_op = RunCrossThread(alloc, set.sizes, ops);
+                AddRow(report, alloc.name, "cross_thread", 2, size, ops, ns_per_op);
+            }
+        }
+    }
+    report.Finish();
+    return 0;
+}
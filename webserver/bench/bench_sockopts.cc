@@ -0,0 +1,197 @@
+// 套接字选项基准: 在回环上比较 SocketOptions 各项设置对延迟和吞吐的影响
+// 用法: bench_sockopts [--json] [--seconds S] [--small BYTES] [--large BYTES]
+// 服务端在子进程中运行, 收到 "<size>\n" 后用 TcpConnection::Send(header, body) 回复头部和 size 字节的 body
+// keepalive: 长连接上一问一答请求 --small 字节的响应, 统计 p50/p99 延迟
+// bulk:      长连接上连续请求 --large 字节的响应, 统计吞吐
+// connect:   每个请求新建连接 (fastopen 配置下用 MSG_FASTOPEN 在 SYN 中携带请求), 统计 p50 延迟和每秒连接数
+// TFO 需要 net.ipv4.tcp_fastopen 同时开启客户端和服务端 (= 3), tfo 列是 SYN 携带了数据的连接数
+
+#include "bench_util.h"
+#include "net/tcp_server.h"
+#include "event/event_loop.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#ifndef MSG_FASTOPEN
+#define MSG_FASTOPEN 0x20000000
+#endif
+#ifndef TCPI_OPT_SYN_DATA
+#define TCPI_OPT_SYN_DATA 32
+#endif
+
+namespace {
+
+struct Profile {
+    const char *name;
+    net::SocketOptions options;
+    bool client_fastopen;
+};
+
+std::string Header(size_t size) {
+    return "HTTP/1.1 200 OK\r\nContent-Length: " + std::to_string(size) + "\r\n\r\n";
+}
+
+void OnMessage(const net::TcpConnectionPtr &conn, net::Buffer *buf) {
+    for (;;) {
+        const char *eol = static_cast<const char*>(memchr(buf->Peek(), '\n', buf->ReadableBytes()));
+        if (eol == nullptr) return;
+        size_t size = strtoul(buf->Peek(), nullptr, 10);
+        buf->RetrieveUntil(eol + 1);
+
+        net::Buffer header;
+        header.Append(Header(size));
+        conn->Send(&header, bench::Body(size));
+    }
+}
+
+pid_t StartServer(uint16_t port, const net::SocketOptions &options) {
+    return bench::StartServer([&]() {
+        event::EventLoop loop;
+        net::TcpServer server(&loop, net::InetAddress(port), "bench");
+        server.SetMessageCallback(OnMessage);
+        server.SetThreadNum(1);
+        server.SetSocketOptions(options);
+        server.Start();
+        loop.Loop();
+    });
+}
+
+// 客户端保持 Nagle 开启, 只比较服务端的设置
+int Connect(uint16_t port) {
+    return bench::Connect(net::InetAddress(port), false);
+}
+
+bool Request(int fd, size_t size) {
+    std::string request = std::to_string(size) + "\n";
+    if (::write(fd, request.data(), request.size()) < 0) return false;
+    return bench::ReadFull(fd, Header(size).size() + size);
+}
+
+// 以下三项各自在当前行追加几列
+void KeepAlive(bench::Report &report, uint16_t port, double seconds, size_t size) {
+    int fd = Connect(port);
+    std::vector<int64_t> samples;
+    int64_t deadline = bench::NowNs() + static_cast<int64_t>(seconds * 1e9);
+    for (int64_t now = bench::NowNs(); now < deadline; now = bench::NowNs()) {
+        if (!Request(fd, size)) break;
+        samples.push_back(bench::NowNs() - now);
+    }
+    ::close(fd);
+    report.Add("keepalive_p50_us", bench::Percentile(samples, 0.5), 1)
+          .Add("keepalive_p99_us", bench::Percentile(samples, 0.99), 1);
+}
+
+void Bulk(bench::Report &report, uint16_t port, double seconds, size_t size) {
+    int fd = Connect(port);
+    size_t bytes = 0;
+    int64_t start = bench::NowNs();
+    int64_t deadline = start + static_cast<int64_t>(seconds * 1e9);
+    while (bench::NowNs() < deadline && Request(fd, size)) {
+        bytes += size;
+    }
+    double elapsed = (bench::NowNs() - start) / 1e9;
+    ::close(fd);
+    report.Add("bulk_mb_per_sec", bytes / elapsed / (1024 * 1024), 0);
+}
+
+// 新建连接并发送请求, fastopen 时请求随 SYN 发出
+int ConnectAndSend(uint16_t port, const std::string &request, bool fastopen) {
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    net::InetAddress addr(port);
+    if (fastopen) {
+        if (::sendto(fd, request.data(), request.size(), MSG_FASTOPEN,
+                     addr.GetSockAddr(), addr.GetSockLen()) < 0) {
+            ::close(fd);
+            return -1;
+        }
+        return fd;
+    }
+    if (::connect(fd, addr.GetSockAddr(), addr.GetSockLen()) < 0
+            || ::write(fd, request.data(), request.size()) < 0) {
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+void ConnectStorm(bench::Report &report, uint16_t port, double seconds, size_t size, bool fastopen) {
+    std::string request = std::to_string(size) + "\n";
+    std::vector<int64_t> samples;
+    size_t tfo = 0;
+    int64_t start = bench::NowNs();
+    int64_t deadline = start + static_cast<int64_t>(seconds * 1e9);
+    for (int64_t now = start; now < deadline; now = bench::NowNs()) {
+        int fd = ConnectAndSend(port, request, fastopen);
+        if (fd < 0) break;
+        bool ok = bench::ReadFull(fd, Header(size).size() + size);
+        tcp_info info;
+        socklen_t len = sizeof(info);
+        if (::getsockopt(fd, IPPROTO_TCP, TCP_INFO, &info, &len) == 0 && (info.tcpi_options & TCPI_OPT_SYN_DATA)) {
+            ++tfo;
+        }
+        ::close(fd);
+        if (!ok) break;
+        samples.push_back(bench::NowNs() - now);
+    }
+    double elapsed = (bench::NowNs() - start) / 1e9;
+    double connects_per_sec = samples.size() / elapsed;
+    report.Add("connect_p50_us", bench::Percentile(samples, 0.5), 1)
+          .Add("connects_per_sec", connects_per_sec, 0)
+          .Add("tfo", tfo);
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    bench::Args args(argc, argv);
+    double seconds = args.Double("--seconds", "S", 1);
+    size_t small = args.Int("--small", "BYTES", 8 * 1024);
+    size_t large = args.Int("--large", "BYTES", 4 * 1024 * 1024);
+    args.Check();
+    // 对端在读完之前关闭连接时不因 SIGPIPE 退出
+    signal(SIGPIPE, SIG_IGN);
+
+    // 除 default 和 nodelay 之外都在 nodelay + cork 的基础上只改一项
+    std::vector<Profile> profiles;
+    net::SocketOptions options;
+    profiles.push_back({ "default", options, false });
+    options.tcp_nodelay = true;
+    profiles.push_back({ "nodelay", options, false });
+    options.cork_responses = true;
+    profiles.push_back({ "nodelay_cork", options, false });
+    net::SocketOptions tuned = options;
+    options.defer_accept = 1;
+    profiles.push_back({ "defer_accept", options, false });
+    options = tuned;
+    options.fastopen_queue = 256;
+    profiles.push_back({ "fastopen", options, true });
+    options = tuned;
+    options.recv_buffer = options.send_buffer = 4 * 1024 * 1024;
+    profiles.push_back({ "buffers_4m", options, false });
+    options = tuned;
+    options.notsent_lowat = 128 * 1024;
+    profiles.push_back({ "notsent_lowat", options, false });
+
+    bench::Report report(args.json());
+    uint16_t port = 15110;
+    for (const Profile &profile : profiles) {
+        pid_t pid = StartServer(port, profile.options);
+        report.Add("profile", profile.name);
+        KeepAlive(report, port, seconds, small);
+        Bulk(report, port, seconds, large);
+        ConnectStorm(report, port, seconds, small, profile.client_fastopen);
+        bench::StopServer(pid);
+        report.EndRow();
+        ++port;
+    }
+    report.Finish();
+    return 0;
+}
@@ -0,0 +1,146 @@
+// 传输方式基准: 同一个服务端同时监听回环 TCP 和 Unix 域套接字, 比较两者的请求速率, 吞吐和建连开销
+// 用法: bench_transport [--json] [--seconds S] [--small BYTES] [--large BYTES] [--clients N]
+// 服务端在子进程中运行, 收到 "<size>\n" 后回复 size 字节
+// rr:      每个客户端在长连接上一问一答请求 --small 字节, 统计每秒请求数和 p50/p99 延迟
+// stream:  单个长连接连续请求 --large 字节, 统计吞吐
+// connect: 每个请求新建连接, 统计每秒完成的连接数
+
+#include "bench_util.h"
+#include "net/tcp_server.h"
+#include "event/event_loop.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include <signal.h>
+#include <unistd.h>
+
+namespace {
+
+const uint16_t kPort = 15120;
+const char *kUnixPath = "@bench_transport";
+
+void OnMessage(const net::TcpConnectionPtr &conn, net::Buffer *buf) {
+    for (;;) {
+        const char *eol = static_cast<const char*>(memchr(buf->Peek(), '\n', buf->ReadableBytes()));
+        if (eol == nullptr) return;
+        size_t size = strtoul(buf->Peek(), nullptr, 10);
+        buf->RetrieveUntil(eol + 1);
+
+        conn->Send(bench::Body(size));
+    }
+}
+
+pid_t StartServer(int threads) {
+    return bench::StartServer([=]() {
+        event::EventLoop loop;
+        net::TcpServer server(&loop, net::InetAddress(kPort), "bench");
+        server.AddListenAddress(net::InetAddress::Unix(kUnixPath));
+        net::SocketOptions options;
+        options.tcp_nodelay = true;
+        server.SetSocketOptions(options);
+        server.SetMessageCallback(OnMessage);
+        server.SetThreadNum(threads);
+        server.Start();
+        loop.Loop();
+    });
+}
+
+int Connect(bool unix_socket) {
+    return bench::Connect(unix_socket ? net::InetAddress::Unix(kUnixPath) : net::InetAddress(kPort));
+}
+
+bool Request(int fd, size_t size) {
+    std::string request = std::to_string(size) + "\n";
+    if (::write(fd, request.data(), request.size()) < 0) return false;
+    return bench::ReadFull(fd, size);
+}
+
+// samples 为空时 (stream) 不统计延迟
+void AddRow(bench::Report &report, const char *scenario, bool unix_socket, size_t ops, double elapsed,
+            std::vector<int64_t> &samples, size_t bytes) {
+    report.Add("scenario", scenario)
+          .Add("transport", unix_socket ? "unix" : "tcp")
+          .Add("ops_per_sec", ops / elapsed, 0)
+          .Add("p50_us", bench::Percentile(samples, 0.5), 1)
+          .Add("p99_us", bench::Percentile(samples, 0.99), 1)
+          .Add("mb_per_sec", bytes / elapsed / (1024 * 1024), 0)
+          .EndRow();
+}
+
+void RequestResponse(bench::Report &report, bool unix_socket, double seconds, size_t size, int clients) {
+    std::vector<std::vector<int64_t>> latencies(clients);
+    std::vector<std::thread> threads;
+    int64_t start = bench::NowNs();
+    int64_t deadline = start + static_cast<int64_t>(seconds * 1e9);
+    for (int i = 0; i < clients; ++i) {
+        std::vector<int64_t> *samples = &latencies[i];
+        threads.emplace_back([=]() {
+            int fd = Connect(unix_socket);
+            for (int64_t now = bench::NowNs(); now < deadline; now = bench::NowNs()) {
+                if (!Request(fd, size)) break;
+                samples->push_back(bench::NowNs() - now);
+            }
+            ::close(fd);
+        });
+    }
+    for (auto &thread : threads) thread.join();
+    double elapsed = (bench::NowNs() - start) / 1e9;
+
+    std::vector<int64_t> all = bench::Merge(latencies);
+    AddRow(report, "rr", unix_socket, all.size(), elapsed, all, all.size() * size);
+}
+
+void Stream(bench::Report &report, bool unix_socket, double seconds, size_t size) {
+    int fd = Connect(unix_socket);
+    size_t requests = 0;
+    int64_t start = bench::NowNs();
+    int64_t deadline = start + static_cast<int64_t>(seconds * 1e9);
+    while (bench::NowNs() < deadline && Request(fd, size)) {
+        ++requests;
+    }
+    double elapsed = (bench::NowNs() - start) / 1e9;
+    ::close(fd);
+    std::vector<int64_t> no_samples;
+    AddRow(report, "stream", unix_socket, requests, elapsed, no_samples, requests * size);
+}
+
+void ConnectStorm(bench::Report &report, bool unix_socket, double seconds, size_t size) {
+    std::vector<int64_t> samples;
+    int64_t start = bench::NowNs();
+    int64_t deadline = start + static_cast<int64_t>(seconds * 1e9);
+    for (int64_t now = start; now < deadline; now = bench::NowNs()) {
+        int fd = Connect(unix_socket);
+        bool ok = Request(fd, size);
+        ::close(fd);
+        if (!ok) break;
+        samples.push_back(bench::NowNs() - now);
+    }
+    double elapsed = (bench::NowNs() - start) / 1e9;
+    AddRow(report, "connect", unix_socket, samples.size(), elapsed, samples, 0);
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    bench::Args args(argc, argv);
+    double seconds = args.Double("--seconds", "S", 1);
+    size_t small = args.Int("--small", "BYTES", 128);
+    size_t large = args.Int("--large", "BYTES", 1024 * 1024);
+    int clients = args.Int("--clients", "N", 4);
+    args.Check();
+    signal(SIGPIPE, SIG_IGN);
+
+    pid_t pid = StartServer(2);
+    bench::Report report(args.json());
+    for (int unix_socket = 0; unix_socket < 2; ++unix_socket) {
+        RequestResponse(report, unix_socket, seconds, small, clients);
+        Stream(report, unix_socket, seconds, large);
+        ConnectStorm(report, unix_socket, seconds, small);
+    }
+    bench::StopServer(pid);
+    report.Finish();
+    return 0;
+}
@@ -0,0 +1,243 @@
+#pragma once
+
+// 基准程序共用的工具: 命令行参数, 计时, 子进程中的服务端, 客户端连接, 分位数和结果输出
+
+#include "utils/uncopyable.h"
+#include "net/blob.h"
+#include "net/inet_address.h"
+#include "log/logger.h"
+#include "memory/memory_pool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <signal.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace bench {
+
+inline int64_t NowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// 命令行参数: --json 和 "--name 数值" 形式的选项
+// 用 Int/Double 逐个取出选项, 同时拼出用法说明; 最后调用 Check, 有不认识的参数时打印用法并退出
+class Args : utils::Uncopyable {
+public:
+    Args(int argc, char *argv[]) : program_(argv[0]), usage_("[--json]"), json_(false), valid_(true) {
+        for (int i = 1; i < argc; ++i) {
+            if (strcmp(argv[i], "--json") == 0) {
+                json_ = true;
+            } else if (strncmp(argv[i], "--", 2) == 0 && i + 1 < argc) {
+                values_[argv[i]] = argv[i + 1];
+                ++i;
+            } else {
+                valid_ = false;
+            }
+        }
+    }
+
+    bool json() const { return json_; }
+
+    // value_name 只用于用法说明, 例如 "N", "BYTES"
+    long long Int(const char *name, const char *value_name, long long default_value) {
+        const char *value = Take(name, value_name);
+        return value ? strtoll(value, nullptr, 10) : default_value;
+    }
+    double Double(const char *name, const char *value_name, double default_value) {
+        const char *value = Take(name, value_name);
+        return value ? atof(value) : default_value;
+    }
+
+    void Check() const {
+        if (valid_ && values_.empty()) return;
+        fprintf(stderr, "usage: %s %s\n", program_, usage_.c_str());
+        exit(1);
+    }
+
+private:
+    const char* Take(const char *name, const char *value_name) {
+        usage_ += std::string(" [") + name + " " + value_name + "]";
+        auto it = values_.find(name);
+        if (it == values_.end()) return nullptr;
+        const char *value = it->second;
+        values_.erase(it);
+        return value;
+    }
+
+    const char *program_;
+    std::string usage_;
+    bool json_;
+    bool valid_;
+    std::map<std::string, const char*> values_;
+};
+
+// 在子进程中运行服务端: 日志写到 /dev/null, 初始化内存池后调用 run, run 运行 EventLoop 直到进程被杀死
+// 父进程等待服务端开始监听后返回子进程 pid
+template <typename Run>
+pid_t StartServer(Run run) {
+    pid_t pid = ::fork();
+    if (pid != 0) {
+        usleep(200 * 1000);
+        return pid;
+    }
+    logging::Logger::SetLogFileName("/dev/null");
+    memory::InitMemoryPool();
+    run();
+    _exit(0);
+}
+
+// 杀死服务端子进程并回收, 返回它消耗的用户态 + 内核态 CPU 时间, 单位毫秒
+inline double StopServer(pid_t pid) {
+    ::kill(pid, SIGKILL);
+    rusage usage;
+    memset(&usage, 0, sizeof(usage));
+    ::wait4(pid, nullptr, 0, &usage);
+    return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000.0
+           + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1000.0;
+}
+
+// 尽量把 RLIMIT_NOFILE 提高到 want, 没有权限提高硬上限时提高到硬上限; 返回之后的软上限
+// fork 出的服务端继承这个上限
+inline rlim_t RaiseFdLimit(rlim_t want) {
+    rlimit limit;
+    getrlimit(RLIMIT_NOFILE, &limit);
+    if (limit.rlim_cur >= want) return limit.rlim_cur;
+    rlimit raised = { want, std::max(want, limit.rlim_max) };
+    if (setrlimit(RLIMIT_NOFILE, &raised) < 0) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+    getrlimit(RLIMIT_NOFILE, &limit);
+    return limit.rlim_cur;
+}
+
+// 连接失败返回 -1; nodelay 只对 TCP 生效
+inline int TryConnect(const net::InetAddress &addr, bool nodelay = true) {
+    int fd = ::socket(addr.family(), SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    if (::connect(fd, addr.GetSockAddr(), addr.GetSockLen()) < 0) {
+        ::close(fd);
+        return -1;
+    }
+    if (nodelay && !addr.IsUnix()) {
+        int one = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+    return fd;
+}
+
+// 连接失败时退出进程
+inline int Connect(const net::InetAddress &addr, bool nodelay = true) {
+    int fd = TryConnect(addr, nodelay);
+    if (fd < 0) {
+        perror("connect");
+        exit(1);
+    }
+    return fd;
+}
+
+// 读取并丢弃 len 字节, 连接断开返回 false
+inline bool ReadFull(int fd, size_t len) {
+    static thread_local char buf[256 * 1024];
+    while (len > 0) {
+        ssize_t n = ::read(fd, buf, std::min(len, sizeof(buf)));
+        if (n <= 0) return false;
+        len -= n;
+    }
+    return true;
+}
+
+// 长度为 size 的只读响应体, 每个线程内每种长度只创建一次
+inline const net::BlobPtr& Body(size_t size) {
+    static thread_local std::map<size_t, net::BlobPtr> bodies;
+    net::BlobPtr &body = bodies[size];
+    if (!body) body = std::make_shared<const net::Blob>(std::string(size, 'x'));
+    return body;
+}
+
+// 合并各个客户端线程的样本
+inline std::vector<int64_t> Merge(const std::vector<std::vector<int64_t>> &samples) {
+    std::vector<int64_t> all;
+    for (const auto &part : samples) all.insert(all.end(), part.begin(), part.end());
+    return all;
+}
+
+// 排序 samples (纳秒) 后返回 p 分位数 (0 ~ 1), 单位微秒
+inline double Percentile(std::vector<int64_t> &samples, double p) {
+    if (samples.empty()) return 0;
+    std::sort(samples.begin(), samples.end());
+    return samples[static_cast<size_t>(p * (samples.size() - 1))] / 1000.0;
+}
+
+// 每行一个结果, 默认输出 CSV (第一行前输出表头), json 时输出 JSON 数组
+// 同一行的列可以分几次 Add, 每行结束后立即 fflush, 便于边跑边看
+class Report : utils::Uncopyable {
+public:
+    explicit Report(bool json) : json_(json), rows_(0) {}
+
+    Report& Add(const char *name, const std::string &value) { return AddField(name, value, true); }
+    Report& Add(const char *name, long long value) { return AddField(name, std::to_string(value), false); }
+    Report& Add(const char *name, double value, int precision) {
+        char text[64];
+        snprintf(text, sizeof(text), "%.*f", precision, value);
+        return AddField(name, text, false);
+    }
+
+    void EndRow() {
+        if (json_) {
+            printf("%s{%s}", rows_ == 0 ? "[\n  " : ",\n  ", row_.c_str());
+        } else {
+            if (rows_ == 0) printf("%s\n", header_.c_str());
+            printf("%s\n", row_.c_str());
+        }
+        fflush(stdout);
+        ++rows_;
+        header_.clear();
+        row_.clear();
+    }
+
+    // JSON 时输出数组的结尾
+    void Finish() {
+        if (json_) printf(rows_ == 0 ? "[]\n" : "\n]\n");
+        fflush(stdout);
+    }
+
+private:
+    Report& AddField(const char *name, const std::string &text, bool quoted) {
+        if (!row_.empty()) {
+            row_ += ',';
+            header_ += ',';
+        }
+        header_ += name;
+        if (json_) {
+            row_ += '"';
+            row_ += name;
+            row_ += "\":";
+            if (quoted) row_ += '"';
+            row_ += text;
+            if (quoted) row_ += '"';
+        } else {
+            row_ += text;
+        }
+        return *this;
+    }
+
+    const bool json_;
+    size_t rows_;
+    std::string header_;
+    std::string row_;
+};
+
+} // namespace bench
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "net/blob.h"
+
 #include <unordered_map>
 #include <string>
 #include <mutex>
@@ -33,7 +35,7 @@ private:
 
 struct Key {
     std::string key_;
-    std::string value_;
+    net::BlobPtr value_;
 };
 
 using KeyNode = Node<Key>;
@@ -66,11 +68,12 @@ public:
     static LfuCache& instance();
     void Init(size_t capacity = 10);
 
-    void Set(const std::string &key, const std::string &value);
-    bool Get(const std::string &key, std::string &value);
+    // 缓存的值是共享的只读数据块, Get 只增加引用计数, 不拷贝内容
+    void Set(const std::string &key, const net::BlobPtr &value);
+    bool Get(const std::string &key, net::BlobPtr &value);
 
 private:
-    LfuCache() {};
+    LfuCache() : capacity_(0), dummy_head_(nullptr) {}
     ~LfuCache();
 
     void AddFreqNode(KeyNode *key_node, FreqNode *freq_node);
@@ -25,6 +25,7 @@ public:
     bool IsNoneEvent() const { return events_ == kNoneEvent; }
     bool IsWriting() const { return events_ & kWriteEvent; }
     bool IsReading() const { return events_ & kReadEvent; }
+    bool IsEdgeTriggered() const { return edge_triggered_; }
 
     void EnableReading() { events_ |= kReadEvent; Update(); }
     void EnableWriting() { events_ |= kWriteEvent; Update(); }
@@ -32,6 +33,9 @@ public:
     void DisableWriting() { events_ &= ~kWriteEvent; Update(); }
     void DisableAll() { events_ = kNoneEvent; Update(); }
 
+    // 边缘触发模式, 需要在注册到 epoll 之前设置; 读写事件的开关和分发与水平触发相同
+    void EnableEdgeTriggered() { events_ |= kEdgeEvent; edge_triggered_ = true; }
+
     void set_holder(const std::shared_ptr<void> &holder) {
         holder_ = holder;
         holded_ = true;
@@ -52,11 +56,13 @@ private:
     static const int kNoneEvent;
     static const int kReadEvent;
     static const int kWriteEvent;
+    static const int kEdgeEvent;
 
     EventLoop *loop_;
     int fd_; // 文件描述符
     int events_; // 注册的事件
     int revents_; // epoll 返回的事件
+    bool edge_triggered_;
 
     std::weak_ptr<void> holder_;
     bool holded_;
@@ -1,10 +1,9 @@
 #pragma once
 
-#include "utils/uncopyable.h"
+#include "event/poller.h"
 
-#include <memory>
+#include <stdint.h>
 #include <vector>
-#include <unordered_map>
 #include <sys/epoll.h>
 
 
@@ -12,32 +11,40 @@ namespace event {
 
 class Channel;
 
-class Epoller : utils::Uncopyable {
+// 兴趣事件的修改先记录下来, 在下一次 epoll_wait 之前统一提交,
+// 同一轮内反复开关写事件不产生系统调用; 删除立即生效, 因为 fd 随后可能被关闭
+class Epoller : public Poller {
 public:
-    using ChannelList = std::vector<Channel*>;
-
     Epoller();
-    ~Epoller();
+    ~Epoller() override;
+
+    void Poll(ChannelList &active_channels, int timeout_ms) override;
 
-    void Poll(ChannelList &active_channels);
+    bool HasChannel(Channel *channel) const override;
 
-    bool HasChannel(Channel *channel) const;
+    void UpdateChannel(Channel *channel) override;
+    void RemoveChannel(Channel *channel) override;
 
-    void UpdateChannel(Channel *channel, int timeout);
-    void RemoveChannel(Channel *channel);
+    const char* name() const override { return "epoll"; }
 
     int epoll_fd() const { return epoll_fd_; }
 private:
-    using ChannelMap = std::unordered_map<int, Channel*>;
+    // 按 fd 索引
+    struct Entry {
+        Channel *channel;
+        uint32_t registered;  // 内核中注册的事件, 0 表示未注册
+        bool dirty;           // 在 dirty_fds_ 中等待提交
+    };
 
-    static const int kEpollTimeOut = 10000;
     static const int kInitEventListSize = 16;
 
-    void Update(int operation, Channel *p_channel);
+    void ApplyUpdates();
+    bool Update(int operation, Channel *channel, uint32_t events);
 
     int epoll_fd_;
     std::vector<epoll_event> ready_events_;
-    ChannelMap channel_map_;
+    std::vector<Entry> entries_;
+    std::vector<int> dirty_fds_;
 };
 
 } // namespace event
@@ -2,20 +2,25 @@
 
 #include "utils/uncopyable.h"
 #include "thread/thread.h"
-#include "epoller.h"
+#include "event/timer.h"
+#include "event/task_queue.h"
+#include "event/loop_stats.h"
+#include "event/poller.h"
 
 #include <functional>
 #include <memory>
 #include <vector>
-#include <mutex>
 #include <atomic>
 
 class Channel;
-class Epoller;
+class Poller;
 
 namespace event
 {
 
+class TimerQueue;
+class TimingWheel;
+
 class EventLoop : utils::Uncopyable {
 public:
     using Function = std::function<void()>;
@@ -30,24 +35,61 @@ public:
 
     void RunInLoop(const Function &func);
     void QueueInLoop(const Function &func);
+    // 在本 loop 线程中执行 func 并等待其完成, 不能在 loop 已退出后调用
+    void RunInLoopAndWait(const Function &func);
+    // 就绪列表: 连接用完本轮预算后剩下的工作, 只能在本线程调用
+    // 每轮处理完 IO 事件之后按入队顺序执行一次, 执行中再入队的留到下一轮, 各连接轮流推进;
+    // 列表非空时 Poll 不阻塞
+    void QueueReady(const Function &func) { ready_functions_.push_back(func); }
+
+    // 定时器, 可以在任意线程调用; time 为 NowMicroseconds() 时间, 间隔单位为秒
+    TimerId RunAt(int64_t time, const TimerCallback &cb);
+    TimerId RunAfter(double delay, const TimerCallback &cb);
+    TimerId RunEvery(double interval, const TimerCallback &cb);
+    void Cancel(TimerId timer_id);
+
+    // 忙轮询: 最近一次有事件之后的 budget_us 微秒内以非阻塞方式轮询, 空闲超过预算后退回阻塞等待
+    // 用 CPU 换取尾延迟, 0 表示关闭; 可以在任意线程调用
+    void SetBusyPoll(int budget_us) { busy_poll_us_ = budget_us; }
+    int busy_poll() const { return busy_poll_us_; }
+
+    // 连接级超时使用的时间轮, 只能在本线程访问
+    TimingWheel* timing_wheel() const { return timing_wheel_.get(); }
 
     bool HasChannel(Channel *channel) const {
-        return epoller_->HasChannel(channel);
+        return poller_->HasChannel(channel);
     }
 
-    void UpdateChannel(Channel *channel, int timeout = 0) {
-        epoller_->UpdateChannel(channel, timeout);
+    void UpdateChannel(Channel *channel) {
+        poller_->UpdateChannel(channel);
     }
     void RemoveChannel(Channel *channel) {
-        epoller_->RemoveChannel(channel);
+        poller_->RemoveChannel(channel);
     }
 
     bool is_in_loop_thread() const { return thread_id_ == current_thread::tid(); }
 
+    // 负载指标, 供 EventLoopThreadPool 选择 loop, 可以在任意线程读写
+    int connection_count() const { return connection_count_.load(std::memory_order_relaxed); }
+    void IncrementConnections() { connection_count_.fetch_add(1, std::memory_order_relaxed); }
+    void DecrementConnections() { connection_count_.fetch_sub(1, std::memory_order_relaxed); }
+
+    // 调度延迟 (微秒): 投递一个任务到它被执行的时间; 上一次探测未返回时取已等待的时间
+    int64_t lag() const;
+    void ProbeLag();
+
+    // 运行统计, 可以在任意线程读取
+    const LoopStats& stats() const { return stats_; }
+
+    // 实际写 eventfd 的次数, 用于观察唤醒合并的效果
+    uint64_t wakeup_count() const { return wakeup_count_.load(std::memory_order_relaxed); }
+
 private:
     static int CreateEventFd();
     void HandleRead();
     void PerformPendingFunctions();
+    void PerformReadyFunctions();
+    int PollTimeout();
 
     using ChannelList = std::vector<Channel*>;
 
@@ -55,11 +97,29 @@ private:
     int wakeup_fd_;
     std::shared_ptr<Channel> wakeup_channel_;
 
-    std::shared_ptr<Epoller> epoller_;
+    std::unique_ptr<Poller> poller_;
+    std::unique_ptr<TimerQueue> timer_queue_;
+    std::unique_ptr<TimingWheel> timing_wheel_;
     ChannelList active_channels_;
 
-    std::mutex mutex_;
-    std::vector<Function> pending_functions_;
+    // 跨线程任务: 无锁队列 + 计数, 每轮只执行本轮开始前入队的任务
+    TaskQueue pending_functions_;
+    std::atomic<size_t> pending_count_;
+    std::atomic_bool wakeup_pending_;  // 已写 eventfd 且 loop 尚未处理, 后续入队无需再唤醒
+    std::atomic<uint64_t> wakeup_count_;
+
+    std::vector<Function> ready_functions_;  // 只在 loop 线程访问
+    std::vector<Function> running_ready_functions_;
+
+    LoopStats stats_;
+
+    std::atomic_int connection_count_;
+    std::atomic<int64_t> lag_us_;
+    std::atomic<int64_t> lag_probe_time_;  // 未返回的探测的发送时间, 0 表示没有
+
+    std::atomic_int busy_poll_us_;
+    std::atomic_bool spinning_;     // 正在忙轮询, 跨线程入队不需要唤醒
+    int64_t last_active_time_;      // 最近一次处理事件或任务的时间, 微秒
 
     std::atomic_bool is_looping_;
     std::atomic_bool is_quit_;
@@ -7,6 +7,7 @@
 #include <memory>
 #include <mutex>
 #include <condition_variable>
+#include <vector>
 
 namespace event {
 
@@ -19,6 +20,10 @@ public:
     EventLoopThread(const ThreadInitCallback &cb = ThreadInitCallback());
     ~EventLoopThread();
 
+    // 需要在 StartLoop 之前设置, EventLoop 在绑定之后才创建
+    void SetCpuAffinity(const std::vector<int> &cpus) { thread_.SetCpuAffinity(cpus); }
+    bool affinity_applied() const { return thread_.affinity_applied(); }
+
     EventLoop* StartLoop();
 
 private:
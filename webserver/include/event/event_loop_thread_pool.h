@@ -1,9 +1,12 @@
 #pragma once
 
 #include "utils/uncopyable.h"
+#include "event/timer.h"
 
+#include <stdint.h>
 #include <functional>
 #include <memory>
+#include <utility>
 #include <vector>
 
 namespace event {
@@ -15,20 +18,72 @@ class EventLoopThreadPool : utils::Uncopyable {
 public:
     using ThreadInitCallback = std::function<void(EventLoop*)>;
 
+    // 新连接分配策略
+    enum Strategy {
+        kRoundRobin,         // 轮询
+        kLeastConnections,   // 当前连接数最少
+        kLeastLag,           // 调度延迟最小, 延迟相近时选连接数少的
+        kPowerOfTwoChoices,  // 随机取两个, 选连接数少的, 相同时选延迟小的
+        kConsistentHash,     // 按 key (通常是对端地址) 一致性哈希, 同一客户端落在同一个 loop
+    };
+
+    // IO 线程的 CPU 放置策略
+    enum Placement {
+        kNoAffinity,  // 不绑定, 由调度器决定
+        kPinCpus,     // 第 i 个线程绑定到 cpus[i % cpus.size()]
+        kCpuSet,      // 所有线程共享 cpus 这个集合, 在集合内由调度器迁移
+        kSpreadNuma,  // 按 sysfs 拓扑每个线程独占一个物理核, 在 NUMA 节点间交替分布
+    };
+
     EventLoopThreadPool(EventLoop *main_loop);
     ~EventLoopThreadPool();
 
     void SetThreadNum(int num_threads);
+    // 需要在 Start 之前设置
+    void SetStrategy(Strategy strategy) { strategy_ = strategy; }
+    // 需要在 Start 之前设置; kSpreadNuma 忽略 cpus
+    void SetPlacement(Placement placement, const std::vector<int> &cpus = std::vector<int>()) {
+        placement_ = placement;
+        placement_cpus_ = cpus;
+    }
+    // 把 main_loop (acceptor) 所在线程绑定到 cpu, kSpreadNuma 时 IO 线程不会使用这个物理核; -1 表示不绑定
+    void SetAcceptorCpu(int cpu) { acceptor_cpu_ = cpu; }
     void Start(const ThreadInitCallback &cb = ThreadInitCallback());
-    EventLoop* GetNextLoop();
+
+    // key 只用于一致性哈希
+    EventLoop* GetNextLoop(uint64_t key = 0);
+    // 所有处理连接的 EventLoop, 没有子线程时只有 main_loop
+    std::vector<EventLoop*> GetAllLoops() const;
+    // 与 GetAllLoops 一一对应, 每个 loop 独占绑定的 CPU, 没有绑定到单个 CPU 时为 -1
+    std::vector<int> GetLoopCpus() const;
 
 private:
+    static const int kVirtualNodes = 64;   // 一致性哈希中每个 loop 的虚拟节点数
+    static const int kLagProbeIntervalMs = 100;
+    static const int kLagResolutionUs = 1000;
+
+    size_t NextRoundRobin();
+    size_t LeastConnections();
+    size_t LeastLag();
+    size_t PowerOfTwoChoices();
+    size_t ConsistentHash(uint64_t key) const;
+    void ProbeLag();
+    std::vector<int> CpusForThread(int index, const std::vector<int> &spread) const;
+
     EventLoop* main_loop_;
     bool is_started_;
     int num_threads_;
     int next_;
+    Strategy strategy_;
+    Placement placement_;
+    std::vector<int> placement_cpus_;
+    int acceptor_cpu_;
+    uint64_t random_state_;
+    std::vector<std::pair<uint64_t, size_t>> hash_ring_;
+    TimerId lag_probe_timer_;
     std::vector<std::unique_ptr<EventLoopThread>> sub_loop_threads_;
     std::vector<EventLoop*> sub_loops_;
+    std::vector<int> sub_loop_cpus_;
 };
     
 } // namespace event
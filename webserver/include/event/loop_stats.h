@@ -0,0 +1,90 @@
+#pragma once
+
+#include "utils/uncopyable.h"
+
+#include <stdint.h>
+#include <time.h>
+#include <atomic>
+#include <string>
+#include <vector>
+
+namespace event {
+
+inline int64_t NowNanoseconds() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// 对数线性直方图: 每个 2 的幂区间再等分为 4 个桶, 相对误差不超过 25%
+// 只允许一个线程写入 (所属 EventLoop 线程), 任意线程可以随时读取, 不需要加锁
+class Histogram : utils::Uncopyable {
+public:
+    static const int kSubBucketBits = 2;
+    static const int kSubBuckets = 1 << kSubBucketBits;
+    static const int kNumBuckets = (64 - kSubBucketBits + 1) * kSubBuckets;
+
+    Histogram();
+
+    void Record(uint64_t value) {
+        Add(buckets_[BucketIndex(value)], 1);
+        Add(count_, 1);
+        Add(sum_, value);
+        if (value > max_.load(std::memory_order_relaxed)) {
+            max_.store(value, std::memory_order_relaxed);
+        }
+    }
+
+    struct Snapshot {
+        uint64_t count;
+        uint64_t sum;
+        uint64_t max;
+        std::vector<uint64_t> buckets;
+
+        double Mean() const { return count ? static_cast<double>(sum) / count : 0; }
+        // 返回所在桶的上界
+        uint64_t Percentile(double p) const;
+    };
+
+    Snapshot GetSnapshot() const;
+
+    static int BucketIndex(uint64_t value);
+    static uint64_t BucketUpperBound(int index);
+
+private:
+    // 单写者, 不需要原子的读-改-写
+    static void Add(std::atomic<uint64_t> &counter, uint64_t n) {
+        counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    std::atomic<uint64_t> buckets_[kNumBuckets];
+    std::atomic<uint64_t> count_;
+    std::atomic<uint64_t> sum_;
+    std::atomic<uint64_t> max_;
+};
+
+// 单个 EventLoop 的运行统计, 时间单位都是纳秒
+// poll_wait: 每轮阻塞在 Poll 中的时间; events: 每轮就绪的 Channel 数
+// handle: 每个 Channel::HandleEvents 的耗时, 用于发现拖慢整个 loop 的慢回调
+// pending_depth / pending_time: 每轮执行的跨线程任务数和总耗时
+// ready_depth: 每轮执行的就绪列表任务数, 即用完预算后被推迟的连接数
+struct LoopStats : utils::Uncopyable {
+    std::atomic<uint64_t> iterations;
+    Histogram poll_wait;
+    Histogram events;
+    Histogram handle;
+    Histogram pending_depth;
+    Histogram pending_time;
+    Histogram ready_depth;
+
+    LoopStats() : iterations(0) {}
+
+    void AddIteration() {
+        iterations.store(iterations.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    // 一行摘要: 计数, 均值, p50/p99/max
+    std::string ToString() const;
+};
+
+} // namespace event
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "utils/uncopyable.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace event {
+
+class Channel;
+
+// IO 多路复用后端接口, 只能在所属 EventLoop 线程调用
+class Poller : utils::Uncopyable {
+public:
+    using ChannelList = std::vector<Channel*>;
+
+    virtual ~Poller() {}
+
+    static const int kPollTimeOut = 10000;  // 默认阻塞等待时间, 毫秒
+
+    // 最多等待 timeout_ms 毫秒, 0 表示不阻塞; 就绪的 Channel 追加到 active_channels
+    virtual void Poll(ChannelList &active_channels, int timeout_ms) = 0;
+
+    virtual bool HasChannel(Channel *channel) const = 0;
+    virtual void UpdateChannel(Channel *channel) = 0;
+    virtual void RemoveChannel(Channel *channel) = 0;
+
+    virtual const char* name() const = 0;
+
+    // 根据环境变量 WEBSERVER_POLLER 选择后端: epoll (默认) 或 io_uring
+    // 内核不支持 io_uring 时回退到 epoll
+    static Poller* NewDefaultPoller();
+
+protected:
+    // 按 fd 下标的表放不下 fd 时扩容, 至少翻倍, 新位置填 empty
+    template <typename T>
+    static void GrowForFd(std::vector<T> &table, int fd, const T &empty) {
+        size_t need = static_cast<size_t>(fd) + 1;
+        if (need > table.size()) table.resize(std::max(need, table.size() * 2), empty);
+    }
+};
+
+} // namespace event
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "utils/uncopyable.h"
+
+#include <stddef.h>
+#include <atomic>
+#include <vector>
+
+namespace event {
+
+// 有界无锁单生产者单消费者环形队列, 容量向上取整为 2 的幂
+// Push 只能在生产者线程调用, Pop 只能在消费者线程调用; 元素按值拷贝, 适合小的 POD
+template <typename T>
+class SpscQueue : utils::Uncopyable {
+public:
+    explicit SpscQueue(size_t capacity)
+            : mask_(RoundUp(capacity) - 1),
+              slots_(mask_ + 1),
+              head_(0),
+              cached_tail_(0),
+              tail_(0),
+              cached_head_(0) {
+    }
+
+    // 队列满时返回 false
+    bool Push(const T &value) {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (head - cached_tail_ > mask_) {
+            cached_tail_ = tail_.load(std::memory_order_acquire);
+            if (head - cached_tail_ > mask_) return false;
+        }
+        slots_[head & mask_] = value;
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // 队列空时返回 false
+    bool Pop(T *value) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail == cached_head_) {
+            cached_head_ = head_.load(std::memory_order_acquire);
+            if (tail == cached_head_) return false;
+        }
+        *value = slots_[tail & mask_];
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    size_t capacity() const { return mask_ + 1; }
+
+private:
+    static size_t RoundUp(size_t n) {
+        size_t size = 2;
+        while (size < n) size <<= 1;
+        return size;
+    }
+
+    static const size_t kCacheLineSize = 64;
+
+    const size_t mask_;
+    std::vector<T> slots_;
+
+    // 生产者和消费者各自的下标放在不同的缓存行, 并缓存对方的下标, 减少缓存行来回迁移
+    // C++11 的 new 不保证 alignas(64), 这里用整行填充隔开, 不依赖对象的起始地址;
+    // 末尾的填充把消费者的下标和外层对象后面的成员隔开
+    char pad0_[kCacheLineSize];
+    std::atomic<size_t> head_;
+    size_t cached_tail_;
+    char pad1_[kCacheLineSize];
+    std::atomic<size_t> tail_;
+    size_t cached_head_;
+    char pad2_[kCacheLineSize];
+};
+
+} // namespace event
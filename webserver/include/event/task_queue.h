@@ -0,0 +1,50 @@
+#pragma once
+
+#include "utils/uncopyable.h"
+
+#include <atomic>
+#include <functional>
+
+namespace event {
+
+// 无锁多生产者单消费者队列 (Vyukov MPSC)
+// Push 可以在任意线程调用, 只需要一次 exchange; Pop 只能在消费者线程调用
+// 出队的节点由消费者回收, 生产者优先复用回收的节点, 稳定运行时入队不再分配内存
+class TaskQueue : utils::Uncopyable {
+public:
+    using Function = std::function<void()>;
+
+    TaskQueue();
+    ~TaskQueue();
+
+    void Push(const Function &func);
+
+    // 队列为空时返回 false; 生产者入队到一半时自旋等待其完成
+    bool Pop(Function *func);
+
+private:
+    struct Node {
+        std::atomic<Node*> next;
+        Function func;
+    };
+
+    // 每个生产者线程缓存的空闲节点, 线程退出时释放
+    struct NodeCache {
+        NodeCache() : head(nullptr) {}
+        ~NodeCache();
+        Node *head;
+    };
+
+    Node* NewNode();
+    void RecycleNode(Node *node);
+    void PushNode(Node *node);
+
+    static thread_local NodeCache t_node_cache_;
+
+    std::atomic<Node*> head_;  // 生产者端, 最后入队的节点
+    Node *tail_;               // 消费者端, 下一个出队节点的前驱
+    Node stub_;
+    std::atomic<Node*> free_;  // 消费者回收的节点, 生产者整体取走放进自己的缓存
+};
+
+} // namespace event
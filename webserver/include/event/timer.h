@@ -0,0 +1,58 @@
+#pragma once
+
+#include "utils/uncopyable.h"
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+
+namespace event {
+
+using TimerCallback = std::function<void()>;
+
+// CLOCK_MONOTONIC 时间, 单位微秒
+int64_t NowMicroseconds();
+
+class Timer : utils::Uncopyable {
+public:
+    Timer(const TimerCallback &cb, int64_t expiration, int64_t interval)
+        : callback_(cb),
+          expiration_(expiration),
+          interval_(interval),
+          repeat_(interval > 0),
+          sequence_(++num_created_) {}
+
+    void Run() const { callback_(); }
+
+    int64_t expiration() const { return expiration_; }
+    bool repeat() const { return repeat_; }
+    int64_t sequence() const { return sequence_; }
+
+    void Restart(int64_t now) { expiration_ = now + interval_; }
+
+private:
+    const TimerCallback callback_;
+    int64_t expiration_;
+    const int64_t interval_;
+    const bool repeat_;
+    const int64_t sequence_;
+
+    static std::atomic<int64_t> num_created_;
+};
+
+// 用于取消定时器, 可以拷贝, 不拥有 Timer
+class TimerId {
+public:
+    TimerId() : timer_(nullptr), sequence_(0) {}
+    TimerId(Timer *timer, int64_t sequence) : timer_(timer), sequence_(sequence) {}
+
+    bool valid() const { return timer_ != nullptr; }
+
+private:
+    friend class TimerQueue;
+
+    Timer *timer_;
+    int64_t sequence_;
+};
+
+} // namespace event
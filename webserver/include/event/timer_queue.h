@@ -0,0 +1,53 @@
+#pragma once
+
+#include "utils/uncopyable.h"
+#include "event/channel.h"
+#include "event/timer.h"
+
+#include <set>
+#include <vector>
+#include <utility>
+
+namespace event {
+
+class EventLoop;
+
+// 基于单个 timerfd 的定时器队列, 按到期时间有序, 增删都是 O(log n)
+// AddTimer 和 Cancel 可以在任意线程调用, 实际操作都转到所属 EventLoop 线程执行
+class TimerQueue : utils::Uncopyable {
+public:
+    explicit TimerQueue(EventLoop *loop);
+    ~TimerQueue();
+
+    TimerId AddTimer(const TimerCallback &cb, int64_t when, int64_t interval);
+    void Cancel(TimerId timer_id);
+
+    size_t size() const { return timers_.size(); }
+
+private:
+    using Entry = std::pair<int64_t, Timer*>;
+    using TimerList = std::set<Entry>;
+    using ActiveTimer = std::pair<Timer*, int64_t>;
+    using ActiveTimerSet = std::set<ActiveTimer>;
+
+    void AddTimerInLoop(Timer *timer);
+    void CancelInLoop(TimerId timer_id);
+    void HandleRead();
+
+    std::vector<Entry> GetExpired(int64_t now);
+    void Reset(const std::vector<Entry> &expired, int64_t now);
+    bool Insert(Timer *timer);
+
+    EventLoop *loop_;
+    const int timer_fd_;
+    Channel timer_channel_;
+
+    TimerList timers_;
+    ActiveTimerSet active_timers_;
+
+    // 到期回调执行期间被取消的周期定时器, 不再重新插入
+    bool calling_expired_timers_;
+    ActiveTimerSet canceling_timers_;
+};
+
+} // namespace event
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "utils/uncopyable.h"
+#include "event/timer.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+namespace event {
+
+class EventLoop;
+
+// 分层哈希时间轮, 每个 EventLoop 一个, 用于连接空闲/读超时这类数量多、经常重置的超时
+// 4 层 x 64 槽, 重新计时和取消都是 O(1), 只在有超时项时才启动 tick 定时器
+class TimingWheel : utils::Uncopyable {
+public:
+    using Callback = std::function<void()>;
+
+    static const int kLevelBits = 6;
+    static const int kSlots = 1 << kLevelBits;
+    static const int kSlotMask = kSlots - 1;
+    static const int kLevels = 4;
+
+    struct Node {
+        Node *prev;
+        Node *next;
+    };
+
+    // 侵入式超时项, 嵌入到连接对象中, 析构时自动从时间轮上摘除
+    class Entry : private Node, utils::Uncopyable {
+    public:
+        explicit Entry(const Callback &cb);
+        ~Entry();
+
+        bool linked() const { return wheel_ != nullptr; }
+
+    private:
+        friend class TimingWheel;
+
+        int64_t expire_tick_;
+        TimingWheel *wheel_;
+        Callback callback_;
+    };
+
+    explicit TimingWheel(EventLoop *loop, double tick = 1.0);
+    ~TimingWheel();
+
+    // timeout 秒后触发, 已经在时间轮上的项会被重新计时; 只能在所属 EventLoop 线程调用
+    void Schedule(Entry *entry, double timeout);
+    void Cancel(Entry *entry);
+
+    size_t size() const { return size_; }
+
+private:
+    void OnTick();
+    void Advance();
+    void Cascade(int level);
+    void Insert(Entry *entry);
+
+    static void InitList(Node *head);
+    static void Append(Node *head, Node *node);
+    static void Unlink(Node *node);
+
+    EventLoop *loop_;
+    const int64_t tick_us_;
+    int64_t current_tick_;  // 下一个待处理的 tick
+    size_t size_;
+    bool started_;
+    TimerId tick_timer_;
+
+    Node slots_[kLevels][kSlots];
+};
+
+} // namespace event
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "event/poller.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+namespace event {
+
+class Channel;
+
+// 基于 io_uring 的后端, 直接使用系统调用, 不依赖 liburing
+// 边缘触发的 Channel 使用 multishot poll, 一次注册持续触发;
+// 水平触发的 Channel 使用一次性 poll, 回调执行后的下一轮重新注册, 保持水平触发语义
+// 注册和取消只写入提交队列, 在 Poll 中与等待合并为一次 io_uring_enter
+class UringPoller : public Poller {
+public:
+    // 内核不支持时返回 nullptr
+    static UringPoller* Create();
+
+    ~UringPoller() override;
+
+    void Poll(ChannelList &active_channels, int timeout_ms) override;
+
+    bool HasChannel(Channel *channel) const override;
+
+    void UpdateChannel(Channel *channel) override;
+    void RemoveChannel(Channel *channel) override;
+
+    const char* name() const override { return "io_uring"; }
+
+private:
+    // 按 fd 索引; user_data 高 32 位是 fd, 低 32 位是 generation,
+    // 每次重新注册或删除都递增 generation, 旧请求的完成事件据此丢弃
+    struct Entry {
+        Channel *channel;
+        uint32_t generation;
+        uint32_t mask;        // 已注册的事件, 包括 EPOLLET
+        uint32_t revents;     // 本轮累积的就绪事件
+        uint32_t round;       // revents 所属的轮次
+        bool armed;           // 内核中有本 generation 的 poll 请求
+        bool rearm_queued;
+    };
+
+    static const unsigned kEntries = 1024;
+
+    UringPoller();
+    bool Init();
+
+    Entry& GetEntry(int fd);
+    void Arm(int fd, Entry &entry);
+    void Disarm(int fd, Entry &entry);
+    void QueueRearm(int fd, Entry &entry);
+    void PrepareRemove(uint64_t user_data);
+    io_uring_sqe* GetSqe();
+    int Enter(unsigned to_submit, unsigned min_complete, unsigned flags, int timeout_ms);
+    void HandleCompletion(const io_uring_cqe &cqe, ChannelList &active_channels);
+
+    int ring_fd_;
+
+    // 提交队列
+    void *sq_ring_ptr_;
+    size_t sq_ring_size_;
+    unsigned *sq_head_;
+    unsigned *sq_tail_;
+    unsigned *sq_mask_;
+    unsigned *sq_array_;
+    io_uring_sqe *sqes_;
+    size_t sqes_size_;
+    unsigned sqe_tail_;      // 本地已填写的 sqe
+    unsigned sqe_submitted_; // 已提交给内核的 sqe
+
+    // 完成队列
+    void *cq_ring_ptr_;
+    size_t cq_ring_size_;
+    unsigned *cq_head_;
+    unsigned *cq_tail_;
+    unsigned *cq_mask_;
+    io_uring_cqe *cqes_;
+
+    std::vector<Entry> entries_;
+    std::vector<int> rearm_list_;
+    uint32_t round_;
+};
+
+} // namespace event
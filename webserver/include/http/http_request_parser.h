@@ -1,7 +1,8 @@
 #pragma once
 
+#include "memory/arena.h"
+
 #include <string>
-#include <unordered_map>
 
 namespace net {
 
@@ -21,30 +22,40 @@ public:
         kGotAll
     };
 
-    HttpRequestParser() : state_(kExpectRequestLine) {}
+    // 解析出的字符串都从 arena 上分配, 生命周期不超过 arena 的下一次 Reset
+    explicit HttpRequestParser(memory::Arena *arena = nullptr)
+        : state_(kExpectRequestLine),
+          arena_(arena),
+          method_(arena),
+          path_(arena),
+          version_(arena),
+          headers_(kInitialHeaderBuckets, memory::ArenaStringHash(),
+                   std::equal_to<memory::ArenaString>(), arena) {}
 
     bool ParseRequest(net::Buffer *input);
     bool GotAll() const { return state_ == kGotAll; }
     void reset();
 
-    const std::string method() const { return method_; }
-    const std::string path() const { return path_; }
-    const std::string version() const { return version_; }
-    const std::unordered_map<std::string, std::string> headers() const { return headers_; }
+    memory::Arena* arena() const { return arena_; }
+
+    const memory::ArenaString& method() const { return method_; }
+    const memory::ArenaString& path() const { return path_; }
+    const memory::ArenaString& version() const { return version_; }
+    const memory::ArenaStringMap& headers() const { return headers_; }
 
-    const std::string GetHeader(const std::string &field) const {
-        auto it = headers_.find(field);
-        return it == headers_.end() ? std::string() : it->second;
-    }
+    const memory::ArenaString& GetHeader(const char *field) const;
 
 private:
+    static const size_t kInitialHeaderBuckets = 16;
+
     bool ParseRequestLine(const char *begin, const char *end);
 
     HttpRequestParseState state_;
-    std::string method_;
-    std::string path_;
-    std::string version_;
-    std::unordered_map<std::string, std::string> headers_;
+    memory::Arena *arena_;
+    memory::ArenaString method_;
+    memory::ArenaString path_;
+    memory::ArenaString version_;
+    memory::ArenaStringMap headers_;
 };
     
 } // namespace http
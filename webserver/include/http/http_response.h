@@ -1,7 +1,10 @@
 #pragma once
 
+#include "memory/arena.h"
+#include "net/blob.h"
+
 #include <string>
-#include <unordered_map>
+#include <cstring>
 
 namespace net {
     
@@ -23,30 +26,55 @@ public:
         k404NotFound = 404
     };
 
-    explicit HttpResponse(bool close_connection)
-        : status_code_(kUnknown),
-          close_connection_(close_connection) {}
+    // 头部和 body 都从 arena 上分配, 回调里的临时数据也可以通过 arena() 分配
+    explicit HttpResponse(bool close_connection, memory::Arena *arena = nullptr)
+        : headers_(kInitialHeaderBuckets, memory::ArenaStringHash(),
+                   std::equal_to<memory::ArenaString>(), arena),
+          status_code_(kUnknown),
+          status_message_(arena),
+          close_connection_(close_connection),
+          has_content_length_(false),
+          body_(arena),
+          arena_(arena) {}
     ~HttpResponse() = default;
 
     void SetStatusCode(HttpStatusCode status_code) { status_code_ = status_code; }
-    void SetStatusMessage(const std::string &message) { status_message_ = message; }
+    void SetStatusMessage(const char *message) { status_message_.assign(message); }
+    void SetStatusMessage(const std::string &message) {
+        status_message_.assign(message.data(), message.size());
+    }
     void SetCloseConnection(bool on) { close_connection_ = on; }
-    void SetBody(const std::string &body) { body_ = body; }
+    void SetBody(const char *data, size_t len) { body_.assign(data, len); }
+    void SetBody(const std::string &body) { SetBody(body.data(), body.size()); }
+    // 共享的只读 body (例如缓存的文件), 不拷贝进响应; AppendToBuffer 只写出头部,
+    // 调用者再单独发送 body_blob()
+    void SetBody(const net::BlobPtr &blob) { body_blob_ = blob; }
 
     bool close_connection() const { return close_connection_; }
+    const net::BlobPtr& body_blob() const { return body_blob_; }
+    memory::Arena* arena() const { return arena_; }
 
+    void AddHeader(const char *key, size_t key_len, const char *value, size_t value_len);
+    void AddHeader(const char *key, const char *value) {
+        AddHeader(key, strlen(key), value, strlen(value));
+    }
     void AddHeader(const std::string &key, const std::string &value) {
-        headers_[key] = value;
+        AddHeader(key.data(), key.size(), value.data(), value.size());
     }
 
     void AppendToBuffer(net::Buffer *output) const;
 
 private:
-    std::unordered_map<std::string, std::string> headers_;
+    static const size_t kInitialHeaderBuckets = 16;
+
+    memory::ArenaStringMap headers_;
     HttpStatusCode status_code_;
-    std::string status_message_;
+    memory::ArenaString status_message_;
     bool close_connection_;
-    std::string body_;
+    bool has_content_length_;  // 回调自己设置了 Content-Length, 例如 HEAD 请求
+    memory::ArenaString body_;
+    net::BlobPtr body_blob_;
+    memory::Arena *arena_;
 };
     
 } // namespace http
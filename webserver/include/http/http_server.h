@@ -15,12 +15,37 @@ class HttpServer : utils::Uncopyable {
 public:
     using HttpCallback = std::function<void(const HttpRequestParser&, HttpResponse&, const std::string&)>;
 
-    HttpServer(event::EventLoop *loop, const net::InetAddress &addr);
+    HttpServer(event::EventLoop *loop, const net::InetAddress &addr,
+               net::TcpServer::Option option = net::TcpServer::kNoReusePort);
     ~HttpServer() = default;
 
     void SetHttpCallback(const HttpCallback &cb) { http_callback_ = cb; }
+    void SetConnectionCallback(const net::ConnectionCallback &cb) { connection_callback_ = cb; }
+    // 例如本机反向代理使用的 Unix 域套接字, 需要在 Start 之前调用
+    void AddListenAddress(const net::InetAddress &addr) { server_.AddListenAddress(addr); }
 
     void SetThreadNum(int num_threads) { server_.SetThreadNum(num_threads); }
+    void SetLoadBalance(event::EventLoopThreadPool::Strategy strategy) { server_.SetLoadBalance(strategy); }
+    void SetThreadPlacement(event::EventLoopThreadPool::Placement placement,
+                            const std::vector<int> &cpus = std::vector<int>()) {
+        server_.SetThreadPlacement(placement, cpus);
+    }
+    void SetAcceptorCpu(int cpu) { server_.SetAcceptorCpu(cpu); }
+    void SetCpuSteering(bool on) { server_.SetCpuSteering(on); }
+    void SetEdgeTriggered(bool on) { server_.SetEdgeTriggered(on); }
+    void SetIoBudget(size_t bytes, int requests) { server_.SetIoBudget(bytes, requests); }
+    // 默认开启 TCP_NODELAY 和 cork_responses, 见 HttpServer 构造函数
+    void SetSocketOptions(const net::SocketOptions &options) { server_.SetSocketOptions(options); }
+    void SetBusyPoll(int usec) { server_.SetBusyPoll(usec); }
+    void SetStatsLogInterval(double seconds) { server_.SetStatsLogInterval(seconds); }
+    void SetMaxConnections(int max_connections) { server_.SetMaxConnections(max_connections); }
+    void SetWaterMarks(size_t high, size_t low) { server_.SetWaterMarks(high, low); }
+    void SetMaxOutputBytes(size_t max_bytes) { server_.SetMaxOutputBytes(max_bytes); }
+
+    // 长连接限制: 空闲超时和请求头读取超时 (秒), 单个连接最多处理的请求数, 0 表示不限制
+    void SetIdleTimeout(double seconds) { server_.SetIdleTimeout(seconds); }
+    void SetHeaderReadTimeout(double seconds) { server_.SetHeaderReadTimeout(seconds); }
+    void SetMaxKeepAliveRequests(int max_requests) { max_keep_alive_requests_ = max_requests; }
 
     void Start();
 
@@ -29,10 +54,17 @@ private:
     void onMessage(const net::TcpConnectionPtr &conn, net::Buffer *buf);
     void onRequest(const net::TcpConnectionPtr &conn, const HttpRequestParser &req);
 
+    static const size_t kMaxHeaderSize = 64 * 1024;
+    static const int kDefaultIdleTimeout = 60;
+    static const int kDefaultHeaderReadTimeout = 10;
+    static const int kDefaultMaxKeepAliveRequests = 1000;
+
     std::string web_root_;
+    int max_keep_alive_requests_;
 
     net::TcpServer server_;
     HttpCallback http_callback_;
+    net::ConnectionCallback connection_callback_;
 };
     
 } // namespace http
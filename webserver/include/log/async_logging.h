@@ -70,7 +70,7 @@ public:
         ++count_;
         if (count_ >= flush_interval_) {
             count_ = 0;
-            Flush();
+            file_->Flush();  // 已持有 mutex_, 不能再调用 Flush()
         }
     }
 
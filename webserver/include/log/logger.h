@@ -57,7 +57,8 @@ enum LogLevel {
 #define LOG_FATAL logging::Logger(__FILE__, __LINE__, FATAL).stream()
 
 #ifdef ON_DEBUG
-#define LOG_DEBUG log::Logger(__FILE__, __LINE__, DEBUG).stream()
+#define LOG_DEBUG logging::Logger(__FILE__, __LINE__, DEBUG).stream()
 #else
-#define LOG_DEBUG false && logging::Logger(__FILE__, __LINE__, DEBUG).stream()
+// 关闭时整条语句 (包括参数求值) 都不会执行; 用 while 而不是 if, 放在 if/else 分支里也不会吞掉外层的 else
+#define LOG_DEBUG while (false) logging::Logger(__FILE__, __LINE__, DEBUG).stream()
 #endif
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "utils/uncopyable.h"
+
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <functional>
+#include <unordered_map>
+
+namespace memory {
+
+// 单调递增的 bump 分配器, 只分配不释放, 通过 Reset 整体回收
+class Arena : utils::Uncopyable {
+public:
+    static const size_t kDefaultBlockSize = 4096;
+
+    explicit Arena(size_t block_size = kDefaultBlockSize);
+    ~Arena();
+
+    void* Allocate(size_t size, size_t align = alignof(std::max_align_t));
+
+    // 复位后保留一块足够容纳上一轮全部数据的内存块, 稳态下不再 malloc
+    void Reset();
+
+    size_t bytes_used() const { return bytes_used_; }
+    size_t capacity() const { return capacity_; }
+
+private:
+    struct Block {
+        Block* next;
+        size_t size;
+    };
+
+    void* AllocateSlow(size_t size, size_t align);
+    Block* NewBlock(size_t size);
+    void FreeBlocks(Block* block);
+
+    const size_t block_size_;
+    Block* head_;      // 当前使用的内存块, 链表指向之前的内存块
+    char* current_;
+    char* end_;
+    size_t bytes_used_;
+    size_t capacity_;
+};
+
+// 可用于标准容器的 Arena 分配器, arena 为空时退化为 operator new
+template <typename T>
+class ArenaAllocator {
+public:
+    using value_type = T;
+
+    template <typename U>
+    struct rebind { using other = ArenaAllocator<U>; };
+
+    ArenaAllocator(Arena* arena = nullptr) : arena_(arena) {}
+
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) : arena_(other.arena()) {}
+
+    T* allocate(size_t n) {
+        if (arena_) {
+            return static_cast<T*>(arena_->Allocate(n * sizeof(T), alignof(T)));
+        }
+        return static_cast<T*>(operator new(n * sizeof(T)));
+    }
+
+    void deallocate(T* p, size_t n) {
+        if (!arena_) operator delete(p);
+    }
+
+    Arena* arena() const { return arena_; }
+
+private:
+    Arena* arena_;
+};
+
+template <typename T, typename U>
+bool operator==(const ArenaAllocator<T>& lhs, const ArenaAllocator<U>& rhs) {
+    return lhs.arena() == rhs.arena();
+}
+
+template <typename T, typename U>
+bool operator!=(const ArenaAllocator<T>& lhs, const ArenaAllocator<U>& rhs) {
+    return lhs.arena() != rhs.arena();
+}
+
+using ArenaString = std::basic_string<char, std::char_traits<char>, ArenaAllocator<char>>;
+
+struct ArenaStringHash {
+    size_t operator()(const ArenaString& str) const {
+        // FNV-1a
+        size_t hash = 14695981039346656037ULL;
+        for (char c : str) {
+            hash ^= static_cast<unsigned char>(c);
+            hash *= 1099511628211ULL;
+        }
+        return hash;
+    }
+};
+
+using ArenaStringMap = std::unordered_map<ArenaString, ArenaString,
+                                          ArenaStringHash, std::equal_to<ArenaString>,
+                                          ArenaAllocator<std::pair<const ArenaString, ArenaString>>>;
+
+} // namespace memory
@@ -1,25 +1,64 @@
 #pragma once
 
 #include <cstddef>
+#include <cstdint>
 #include <mutex>
+#include <atomic>
+#include <vector>
 
 const int kBlockSize = 4096;
 
 namespace memory {
 
+// 小对象 8 字节一档共 64 档; 大对象 640 ~ 256K 每个 2 的幂区间再等分 4 档 (间隔 1.25x),
+// 共 36 档; 更大的直接 mmap
+const size_t kSmallSizeLimit = 512;
+const size_t kLargeSizeLimit = 256 * 1024;
+const int kNumSmallClasses = 64;
+const int kLargeClassesPerPower = 4;
+const int kNumLargeClasses = 9 * kLargeClassesPerPower;
+const int kNumSizeClasses = kNumSmallClasses + kNumLargeClasses;
+
+const size_t kPageRunSize = 64 * 1024;  // 大对象 slab 的最小页段大小
+const size_t kSlotsPerRun = 4;
+const size_t kMaxAlign = 64;
+
 struct Slot {
     Slot* next;
 };
 
+// 单个档位的统计快照, 速率由调用方对两次快照的计数差除以时间差得到
+struct PoolStats {
+    size_t slot_size;
+    size_t block_size;
+    uint64_t allocations;
+    uint64_t deallocations;
+    uint64_t live_slots;
+    uint64_t peak_slots;
+    uint64_t blocks;
+    uint64_t padding_bytes;  // 存活对象向上取整到档位大小浪费的字节数
+};
+
+struct MemoryStats {
+    int64_t timestamp_us;  // CLOCK_MONOTONIC
+    std::vector<PoolStats> classes;
+    uint64_t huge_allocations;  // 超过 kLargeSizeLimit 直接 mmap 的分配
+    uint64_t huge_deallocations;
+    uint64_t huge_live_bytes;
+};
+
 class MemoryPool {
 public:
     MemoryPool();
     ~MemoryPool();
 
-    void Init(int slot_size);
+    void Init(int slot_size, size_t block_size = kBlockSize);
+
+    // size 为调用方实际请求的大小, 只用于统计对齐浪费
+    Slot* Allocate(size_t size = 0);
+    void Deallocate(Slot* p, size_t size = 0);
 
-    Slot* Allocate();
-    void Deallocate(Slot* p);
+    PoolStats Stats() const;
 
 private:
     size_t PadPointer(char *p, size_t align) {
@@ -31,7 +70,10 @@ private:
     Slot* AllocateBlock();
     Slot* NoFreeSolve();
 
+    bool UsePageRun() const { return block_size_ > static_cast<size_t>(kBlockSize); }
+
     int slot_size_;
+    size_t block_size_;
 
     Slot* current_block_;  // 内存块链表的头指针
     Slot* current_slot_;   // 元素链表的头指针
@@ -40,9 +82,23 @@ private:
 
     std::mutex mutex_free_slot_;
     std::mutex mutex_other_;
+
+    std::atomic<uint64_t> allocations_;
+    std::atomic<uint64_t> deallocations_;
+    std::atomic<uint64_t> live_slots_;
+    std::atomic<uint64_t> peak_slots_;
+    std::atomic<uint64_t> blocks_;
+    std::atomic<uint64_t> padding_bytes_;
 };
 
 MemoryPool& GetMemoryPool(int index);
+MemoryStats SnapshotMemoryStats();
+
+// 定义 MEMORY_POOL_DEBUG 时记录每次分配的调用栈, 检查重复释放,
+// 并在进程退出时报告未释放的内存; 返回泄漏的对象数
+size_t CheckMemoryLeaks();
+int SizeClassIndex(size_t size);
+size_t SizeClassSlotSize(int index);
 
 void InitMemoryPool();
 void* UseMemory(size_t size);
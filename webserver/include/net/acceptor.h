@@ -0,0 +1,74 @@
+#pragma once
+
+#include "utils/uncopyable.h"
+#include "net/socket.h"
+#include "net/socket_options.h"
+#include "event/channel.h"
+#include "event/timer.h"
+
+#include <functional>
+#include <memory>
+#include <string>
+
+namespace event {
+class EventLoop;
+}
+
+namespace net {
+
+class InetAddress;
+
+// 监听套接字及其 Channel, 在所属 loop 线程中 accept 新连接
+// 每次可读事件 accept 到 EAGAIN 为止, 最多 kMaxAcceptsPerEvent 个, 剩下的由水平触发在下一轮继续
+class Acceptor : utils::Uncopyable {
+public:
+    using NewConnectionCallback = std::function<void(int sockfd, const InetAddress &peer_addr)>;
+    using BatchDoneCallback = std::function<void()>;
+
+    // 构造时完成 socket + bind; Unix 域套接字路径上残留的套接字文件会先被删除
+    Acceptor(event::EventLoop *loop, const InetAddress &addr, bool reuse_port);
+    // 只能在所属 loop 线程中析构, 同时删除自己创建的 Unix 域套接字文件
+    ~Acceptor();
+
+    void SetNewConnectionCallback(const NewConnectionCallback &cb) { new_connection_callback_ = cb; }
+    // 一次可读事件中的连接都交给 NewConnectionCallback 之后调用, 用于批量通知其他线程
+    void SetBatchDoneCallback(const BatchDoneCallback &cb) { batch_done_callback_ = cb; }
+    // 监听套接字相关的选项在 Listen 中设置
+    void SetSocketOptions(const SocketOptions &options) { options_ = options; }
+
+    // 在调用线程中 listen, 然后在所属 loop 线程中开始监听可读事件
+    // 多个 SO_REUSEPORT 监听者按 listen 的顺序加入内核的 reuseport 组
+    void Listen();
+    bool listening() const { return listening_; }
+
+    event::EventLoop* GetLoop() const { return loop_; }
+    Socket* socket() const { return accept_socket_.get(); }
+
+    static const int kMaxAcceptsPerEvent = 64;
+    // 预留的 fd 无法重新打开时, 暂停监听并每隔这么多毫秒重试
+    static const int kIdleFdRetryMs = 100;
+
+private:
+    void HandleRead();
+    int AcceptBatch();
+    // fd 耗尽 (EMFILE/ENFILE) 时释放预留的 fd, 接受并立即关闭一个连接, 再重新预留
+    // 否则监听套接字一直可读, 水平触发下 loop 会空转
+    void DropConnection();
+    // 没有预留 fd 时无法丢弃连接, 停止监听可读事件, 避免水平触发空转, 由定时器重试预留
+    void PauseAccepting();
+    void RetryIdleFd();
+
+    event::EventLoop *loop_;
+    std::unique_ptr<Socket> accept_socket_;
+    std::unique_ptr<event::Channel> accept_channel_;
+    NewConnectionCallback new_connection_callback_;
+    BatchDoneCallback batch_done_callback_;
+    SocketOptions options_;
+    bool listening_;
+    int idle_fd_;  // 预留的 /dev/null
+    event::TimerId retry_timer_;
+    const bool is_unix_;
+    std::string unix_path_;  // 文件系统中的 Unix 域套接字路径, 抽象命名空间和 TCP 时为空
+};
+
+} // namespace net
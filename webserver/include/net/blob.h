@@ -0,0 +1,27 @@
+#pragma once
+
+#include "utils/uncopyable.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+
+namespace net {
+
+// 不可变的共享数据块, 例如缓存的文件内容
+// 多个连接的输出缓冲区可以同时引用同一个 Blob, 发送时不需要拷贝
+class Blob : utils::Uncopyable {
+public:
+    explicit Blob(std::string &&data) : data_(std::move(data)) {}
+    Blob(const char *data, size_t len) : data_(data, len) {}
+
+    const char* data() const { return data_.data(); }
+    size_t size() const { return data_.size(); }
+
+private:
+    const std::string data_;
+};
+
+using BlobPtr = std::shared_ptr<const Blob>;
+
+} // namespace net
@@ -13,6 +13,8 @@ class Buffer : utils::Uncopyable {
 public:
     static const size_t kPrependSize = 8;
     static const size_t kInitialSize = 1024;
+    static const size_t kMaxIdleSize = 64 * 1024;
+    static const int kMaxSpillChunks = 4;
 
     explicit Buffer(size_t initial_size = kInitialSize)
         : buffer_(kPrependSize + initial_size),
@@ -89,12 +91,26 @@ public:
         Append(str.data(), str.size());
     }
 
+    void Append(const char* str) {
+        Append(str, strlen(str));
+    }
+
     void EnsureWritableBytes(size_t len) {
         if (WritableBytes() < len) {
             MakeSpace(len);
         }
     }
 
+    // 没有可读数据且容量超过 kMaxIdleSize 时释放多余内存, 由连接在空闲时调用
+    void ShrinkIfIdle() {
+        if (ReadableBytes() == 0 && buffer_.size() > kPrependSize + kMaxIdleSize) {
+            std::vector<char>(kPrependSize + kInitialSize).swap(buffer_);
+            RetrieveAll();
+        }
+    }
+
+    size_t Capacity() const { return buffer_.size(); }
+
     ssize_t ReadFd(int fd, int* saved_errno);
     ssize_t WriteFd(int fd, int* saved_errno);
 
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "utils/uncopyable.h"
+#include "net/blob.h"
+
+#include <deque>
+#include <string>
+#include <sys/types.h>
+
+namespace net {
+
+// 由 ChunkPool 固定大小内存块串成的缓冲区, 不要求数据连续,
+// 已读完的内存块立即归还线程局部的 ChunkPool, 空闲连接不占用缓冲内存
+// 也可以直接引用共享的 Blob 作为一段数据, 发送大块只读数据时不需要拷贝
+class ChainBuffer : utils::Uncopyable {
+public:
+    static const int kMaxIovecs = 64;
+    static const int kMaxReadChunks = 4;
+    // 小于这个长度的 Blob 直接拷贝进内存块, 避免产生很多零碎的 iovec
+    static const size_t kMinBlobSegment = 4096;
+
+    ChainBuffer() : readable_(0) {}
+    ~ChainBuffer();
+
+    size_t ReadableBytes() const { return readable_; }
+    size_t NumChunks() const { return chunks_.size(); }
+
+    void Append(const char *data, size_t len);
+    void Append(const std::string &str) { Append(str.data(), str.size()); }
+    // 引用 blob 中从 offset 开始的数据, 在数据发送完之前持有 blob
+    void Append(const BlobPtr &blob, size_t offset = 0);
+
+    void Retrieve(size_t len);
+    void RetrieveAll();
+
+    ssize_t ReadFd(int fd, int *saved_errno);
+    // blob_limit 不为 0 时, writev 在长度不小于它的 blob 分段之前停止, 这些分段由 FrontBlob 取出单独发送
+    ssize_t WriteFd(int fd, int *saved_errno, size_t blob_limit = 0);
+    // 头部是剩余长度不小于 min_len 的 blob 分段时返回该 blob 及剩余数据的位置, 否则返回空
+    BlobPtr FrontBlob(size_t min_len, const char **data, size_t *len) const;
+
+private:
+    struct Chunk {
+        char *data;
+        size_t read_index;
+        size_t write_index;
+        BlobPtr blob;  // 非空时 data 指向 blob 的数据, 不属于 ChunkPool, 也不能再追加
+    };
+
+    // 尾部是可以继续追加数据的内存块
+    bool TailWritable() const { return !chunks_.empty() && !chunks_.back().blob; }
+    void PushChunk(char *data, size_t write_index);
+    void PopChunk();
+
+    std::deque<Chunk> chunks_;
+    size_t readable_;
+};
+
+} // namespace net
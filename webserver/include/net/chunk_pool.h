@@ -0,0 +1,30 @@
+#pragma once
+
+#include "utils/uncopyable.h"
+
+#include <cstddef>
+#include <vector>
+
+namespace net {
+
+// 固定大小内存块的线程局部缓存池, 每个 EventLoop 线程一份
+class ChunkPool : utils::Uncopyable {
+public:
+    static const size_t kChunkSize = 16 * 1024;
+    static const size_t kMaxCachedChunks = 64;
+
+    static ChunkPool& ThreadLocal();
+
+    ChunkPool() { free_chunks_.reserve(kMaxCachedChunks); }
+    ~ChunkPool();
+
+    char* Allocate();
+    void Deallocate(char *chunk);
+
+    size_t cached_chunks() const { return free_chunks_.size(); }
+
+private:
+    std::vector<char*> free_chunks_;
+};
+
+} // namespace net
@@ -1,25 +1,48 @@
 #pragma once
 
 #include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/un.h>
 #include <string>
 
 namespace net {
 
+// 套接字地址: IPv4, IPv6 或 Unix 域套接字 (AF_UNIX)
 class InetAddress {
 public:
+    // ip 中含有 ':' 时按 IPv6 解析, 例如 "::1", "::"
     explicit InetAddress(uint16_t port = 0, const std::string &ip = "127.0.0.1");
-    explicit InetAddress(const sockaddr_in &addr);
+    InetAddress(const sockaddr *addr, socklen_t len);
 
-    std::string GetIp() const { return ip_; }
-    uint16_t GetPort() const { return port_; }
-    std::string GetIpPort() const { return ip_ + ":" + std::to_string(port_); }
+    // Unix 域套接字地址, 以 '@' 开头表示 Linux 抽象命名空间, 不在文件系统中创建文件
+    static InetAddress Unix(const std::string &path);
+
+    sa_family_t family() const { return addr_.sa.sa_family; }
+    bool IsUnix() const { return family() == AF_UNIX; }
+    bool IsAbstract() const;
+
+    // 字符串形式按需从 sockaddr 转换, accept 路径上不做格式化
+    // Unix 域套接字: GetIp 返回路径 (抽象命名空间以 '@' 开头), GetPort 返回 0
+    std::string GetIp() const;
+    uint16_t GetPort() const;
+    // "1.2.3.4:80", "[::1]:80" 或 "unix:/path"
+    std::string GetIpPort() const;
+
+    // 同一个 IP 得到相同的值, 用于按客户端 IP 选择 loop; Unix 域套接字返回 0
+    uint32_t IpHash() const;
+
+    const sockaddr* GetSockAddr() const { return &addr_.sa; }
+    socklen_t GetSockLen() const { return len_; }
+    void SetSockAddr(const sockaddr *addr, socklen_t len);
 
-    const sockaddr_in* GetSockAddr() const { return &addr_; }
-    void SetSockAddr(const sockaddr_in &addr) { addr_ = addr; }
 private:
-    sockaddr_in addr_;
-    uint16_t port_;
-    std::string ip_;
+    union {
+        sockaddr sa;
+        sockaddr_in v4;
+        sockaddr_in6 v6;
+        sockaddr_un un;
+    } addr_;
+    socklen_t len_;
 };
     
 } // namespace connection
@@ -2,6 +2,9 @@
 
 #include "utils/uncopyable.h"
 
+#include <sys/socket.h>
+#include <vector>
+
 namespace net {
 
 class InetAddress;
@@ -12,7 +15,7 @@ public:
     ~Socket();
 
     void Bind(const InetAddress &addr);
-    void Listen();
+    void Listen(int backlog = SOMAXCONN);
     int Accept(InetAddress *peer_addr);
 
     void ShutdownWrite();
@@ -22,6 +25,29 @@ public:
     void SetReusePort(bool on);
     void SetKeepAlive(bool on);
 
+    // 以下选项失败时记录日志并返回 false
+    // TCP_DEFER_ACCEPT: 监听套接字上设置, 握手完成后等到收到数据 (最多 seconds 秒) 才唤醒 accept
+    bool SetDeferAccept(int seconds);
+    // TCP_FASTOPEN: 监听套接字上设置, 允许的未完成 TFO 连接数
+    bool SetFastOpen(int queue_len);
+    bool SetRecvBuffer(int bytes);
+    bool SetSendBuffer(int bytes);
+    // TCP_NOTSENT_LOWAT: 内核中未发送的数据低于 bytes 才报告可写, 减少积压在发送缓冲区里的数据
+    bool SetNotSentLowat(int bytes);
+    // SO_ZEROCOPY: 允许在这个套接字上使用 MSG_ZEROCOPY 发送, 需要 Linux 4.14 以上
+    bool SetZeroCopy(bool on);
+
+    // 内核忙轮询 (SO_BUSY_POLL, 微秒) 和优先忙轮询 (SO_PREFER_BUSY_POLL)
+    // 超过 net.core.busy_poll 需要 CAP_NET_ADMIN, 失败返回 false
+    bool SetBusyPoll(int usec);
+    bool SetPreferBusyPoll(bool on);
+
+    // SO_INCOMING_CPU: 监听套接字上设置时, 内核在 SO_REUSEPORT 组内优先选择与收包 CPU 相同的监听者
+    bool SetIncomingCpu(int cpu);
+    // 在 SO_REUSEPORT 组上挂载 CBPF 程序: 收包 CPU 为 cpus[i] 时选择组内第 i 个监听套接字,
+    // 其他 CPU 按 cpu % cpus.size() 选择; 组内顺序即 listen 的顺序, 对整个组生效
+    bool AttachReusePortCpuSteering(const std::vector<int> &cpus);
+
     int fd() const { return sockfd_; }
 private:
     int sockfd_;
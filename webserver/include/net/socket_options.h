@@ -0,0 +1,34 @@
+#pragma once
+
+#include <stddef.h>
+#include <sys/socket.h>
+
+namespace net {
+
+// TcpServer 的套接字调优参数, 0 表示保持内核默认
+// 监听套接字: listen_backlog, defer_accept, fastopen_queue, 以及收发缓冲区 (accept 得到的连接继承)
+// 每个连接: tcp_nodelay, notsent_lowat, cork_responses, zerocopy_threshold
+struct SocketOptions {
+    int listen_backlog;   // listen 队列长度
+    int defer_accept;     // TCP_DEFER_ACCEPT 秒数, 客户端发来数据之后连接才可以 accept
+    int fastopen_queue;   // TCP_FASTOPEN 队列长度, 允许客户端在 SYN 中携带请求, 需要 net.ipv4.tcp_fastopen 开启服务端
+    int recv_buffer;      // SO_RCVBUF 字节数, 设置后内核不再自动调节
+    int send_buffer;      // SO_SNDBUF 字节数
+    bool tcp_nodelay;     // 关闭 Nagle 算法
+    int notsent_lowat;    // TCP_NOTSENT_LOWAT 字节数, 内核中未发送的数据低于这个值才报告可写
+    bool cork_responses;  // 头部和 body 分开发送时, 头部使用 MSG_MORE 等 body 一起发出
+    size_t zerocopy_threshold;  // 不小于这个字节数的 Blob 使用 MSG_ZEROCOPY 发送, 0 表示关闭
+
+    SocketOptions()
+            : listen_backlog(SOMAXCONN),
+              defer_accept(0),
+              fastopen_queue(0),
+              recv_buffer(0),
+              send_buffer(0),
+              tcp_nodelay(false),
+              notsent_lowat(0),
+              cork_responses(false),
+              zerocopy_threshold(0) {}
+};
+
+} // namespace net
@@ -3,11 +3,16 @@
 #include "utils/uncopyable.h"
 #include "net/inet_address.h"
 #include "net/buffer.h"
+#include "net/chain_buffer.h"
+#include "net/blob.h"
+#include "net/socket_options.h"
 #include "event/channel.h"
+#include "event/timing_wheel.h"
 
 #include <functional>
 #include <memory>
 #include <atomic>
+#include <deque>
 #include <string>
 
 namespace event {
@@ -31,27 +36,93 @@ using HighWaterMarkCallback = std::function<void(const TcpConnectionPtr&, size_t
 
 class Socket;
 
+// 同一个 TcpServer 的所有连接共享的输出流控状态, 各 IO 线程并发更新
+struct FlowControl {
+    FlowControl() : max_output_bytes(0), output_bytes(0), paused_connections(0), pause_events(0) {}
+
+    size_t max_output_bytes;                // 所有连接输出缓冲区的总字节数上限, 0 表示不限制
+    std::atomic<size_t> output_bytes;       // 当前所有连接输出缓冲区的总字节数
+    std::atomic<int> paused_connections;    // 当前暂停读取的连接数
+    std::atomic<uint64_t> pause_events;     // 累计暂停读取的次数
+
+    bool OverLimit() const {
+        return max_output_bytes > 0 && output_bytes.load(std::memory_order_relaxed) > max_output_bytes;
+    }
+};
+
 class TcpConnection
         : utils::Uncopyable,
           public std::enable_shared_from_this<TcpConnection> {
 public:
     TcpConnection(event::EventLoop *loop,
                   int sockfd,
-                  const InetAddress &local_addr,
                   const InetAddress &peer_addr);
     ~TcpConnection();
 
     event::EventLoop* GetLoop() const { return loop_; }
     const int fd() const { return channel_->fd(); }
-    const InetAddress& local_addr() const { return local_addr_; }
+    // 第一次访问时才调用 getsockname
+    const InetAddress& local_addr() const;
     const InetAddress& peer_addr() const { return peer_addr_; }
 
     bool Connected() const { return state_ == kConnected; }
     bool Disconnected() const { return state_ == kDisconnected; }
 
+    // 可以在任意线程调用. 在其他线程调用时数据转移给所属 loop, 不拷贝:
+    // std::string&& 和 Buffer 的内容被移走, Blob 只增加引用计数
+    // const std::string& 在其他线程调用时拷贝一次; Send(Buffer*) 与 Send(Buffer&&) 相同, 调用后 buffer 为空
     void Send(const std::string &message);
+    void Send(std::string &&message);
     void Send(Buffer *buffer);
+    void Send(Buffer &&buffer);
+    void Send(const BlobPtr &blob);
+    // 头部和 body 连续发送, 开启 cork_responses 时头部使用 MSG_MORE, 与 body 合并成尽量少的报文
+    // header 的内容被移走, 调用后为空
+    void Send(Buffer *header, const BlobPtr &body);
     void Shutdown();
+    void ForceClose();
+
+    // 超时设置, 单位秒, 0 表示不限制; 需要在 ConnectionEstablished 之前设置
+    // idle: 没有未处理完的请求时, 两次读写之间的最大间隔
+    // header_read: 收到请求的第一个字节后, 必须在此时间内收齐请求头
+    void SetIdleTimeout(double seconds) { idle_timeout_ = seconds; }
+    void SetHeaderReadTimeout(double seconds) { header_read_timeout_ = seconds; }
+
+    // 边缘触发模式: 每次事件循环读写直到 EAGAIN 或用完本轮的字节预算
+    // 可写事件在连接建立时注册后一直保留, 不随输出缓冲区的变化反复 epoll_ctl,
+    // 所以是否有待写数据看输出缓冲区, 不看 Channel::IsWriting; 需要在 ConnectionEstablished 之前设置
+    void SetEdgeTriggered(bool on) { if (on) channel_->EnableEdgeTriggered(); }
+
+    // 每轮事件循环的处理预算, 防止一个连接的大量输入或长串流水线请求拖慢同一线程上的其他连接
+    // bytes: 边缘触发时单轮最多读写的字节数; requests: 单轮最多处理的请求数; 0 表示不限制
+    // 用完预算后剩下的工作放进 loop 的就绪列表, 下一轮和其他连接轮流继续
+    void SetIoBudget(size_t bytes, int requests) { budget_bytes_ = bytes; budget_requests_ = requests; }
+    // 由上层协议在处理每个请求之前调用; 返回 false 时本轮预算已用完, 应停止解析并直接返回,
+    // 输入缓冲区里剩下的请求会在之后的轮次中重新交给 MessageCallback
+    bool ConsumeRequestBudget();
+
+    static const size_t kDefaultBudgetBytes = 256 * 1024;
+    static const int kDefaultBudgetRequests = 16;
+
+    // 输出流控: 输出缓冲区超过 high 字节 (或所属服务端的输出总量超过上限) 时停止读取,
+    // 不再解析新的请求, 直到输出缓冲区降到 low 字节以下; 需要在 ConnectionEstablished 之前设置
+    void SetWaterMarks(size_t high, size_t low) { high_water_mark_ = high; low_water_mark_ = low; }
+    void SetFlowControl(const std::shared_ptr<FlowControl> &flow_control) { flow_control_ = flow_control; }
+    bool reading_paused() const { return reading_paused_; }
+
+    // 设置连接级的套接字选项: TCP_NODELAY, TCP_NOTSENT_LOWAT, cork_responses 和 zerocopy_threshold,
+    // 其余选项只作用于监听套接字
+    void SetSocketOptions(const SocketOptions &options);
+    void SetTcpNoDelay(bool on);
+    // 当前是否对大 Blob 使用 MSG_ZEROCOPY; 内核报告发送时仍然发生了拷贝后自动关闭
+    bool zerocopy_enabled() const { return zerocopy_threshold_ > 0; }
+
+    // 在套接字上开启内核忙轮询, 失败返回 false
+    bool SetBusyPoll(int usec);
+
+    // 已处理的请求数, 由上层协议维护, 用于限制长连接上的请求数
+    int IncrementRequests() { return ++requests_; }
+    int requests() const { return requests_; }
 
     void SetConnectionCallback(const ConnectionCallback &cb) { connection_callback_ = cb; }
     void SetMessageCallback(const MessageCallback &cb) { message_callback_ = cb; }
@@ -60,7 +131,7 @@ public:
     void SetHighWaterMarkCallback(const HighWaterMarkCallback &cb) { high_water_mark_callback_ = cb; }
 
     Buffer* input_buffer() { return &input_buffer_; }
-    Buffer* output_buffer() { return &output_buffer_; }
+    ChainBuffer* output_buffer() { return &output_buffer_; }
 
     void ConnectionEstablished();
     void ConnectionDestroyed();
@@ -78,22 +149,53 @@ private:
     void HandleClose();
     void HandleError();
 
-    void SendInLoop(const void *data, size_t len);
+    // more 为 true 时后面紧接着还有数据, 直接写时使用 MSG_MORE
+    void SendInLoop(const void *data, size_t len, bool more = false);
+    void SendBlobInLoop(const BlobPtr &blob);
+    void SendWithBodyInLoop(const void *header, size_t len, const BlobPtr &body);
+    // 输出缓冲区为空时直接写, 返回写入的字节数; 对端已关闭时返回 -1
+    // zerocopy_blob 非空时 data 属于这个 blob, 使用 MSG_ZEROCOPY 发送
+    ssize_t WriteDirect(const void *data, size_t len, int flags, const BlobPtr *zerocopy_blob = nullptr);
+    // MSG_ZEROCOPY 发送, 成功时持有 blob 直到内核的完成通知; 返回值和 errno 同 send
+    ssize_t SendZeroCopy(const void *data, size_t len, int flags, const BlobPtr &blob);
+    // 读取套接字错误队列中的完成通知, 释放对应的 blob; 返回是否读到了通知
+    bool HandleZeroCopyCompletions();
+    // 剩余 remaining 字节进入输出缓冲区之前调用: 检查高水位并注册写事件
+    void PrepareQueue(size_t remaining);
+    // 输出缓冲区长度变化后调用: 更新服务端的输出总量, 按水位暂停或恢复读取
+    void UpdateFlowControl();
+    void PauseReading();
+    void ResumeReading();
+    // 对端已关闭写端, 并且收到的请求都已处理, 输出也已发完时关闭连接
+    void CloseIfDrained();
     void ShutdownInLoop();
+    void ForceCloseInLoop();
+
+    // 把没做完的读取或请求处理放进就绪列表, 每个连接同时最多一个
+    void ScheduleContinue();
+    void Continue();
+    void QueueWrite();
+
+    void RefreshTimeout();
+    void HandleTimeout();
 
     void SetState(State state) { state_ = state; }
 
+    static const size_t kDefaultHighWaterMark = 1024 * 1024;
+    static const size_t kDefaultLowWaterMark = 256 * 1024;
+
     event::EventLoop *loop_;
     std::atomic_int state_;
 
     std::unique_ptr<Socket> socket_;
     std::unique_ptr<event::Channel> channel_;
 
-    const InetAddress local_addr_;
+    mutable InetAddress local_addr_;
+    mutable bool local_addr_resolved_;
     const InetAddress peer_addr_;
 
     Buffer input_buffer_;
-    Buffer output_buffer_;
+    ChainBuffer output_buffer_;
 
     ConnectionCallback connection_callback_;
     MessageCallback message_callback_;
@@ -102,6 +204,34 @@ private:
     HighWaterMarkCallback high_water_mark_callback_;
 
     size_t high_water_mark_;
+    size_t low_water_mark_;
+    bool reading_paused_;
+    bool peer_closed_;  // 读到 EOF 后不再读取, 处理完已收到的请求并发完输出再关闭
+    std::shared_ptr<FlowControl> flow_control_;
+    size_t accounted_output_;  // 已计入 flow_control_->output_bytes 的字节数
+
+    bool cork_responses_;
+
+    // 等待完成通知的 MSG_ZEROCOPY 发送, 按序号递增排列
+    struct ZeroCopySend {
+        uint32_t seq;
+        BlobPtr blob;
+    };
+    size_t zerocopy_threshold_;  // 0 表示不使用 MSG_ZEROCOPY
+    uint32_t zerocopy_next_seq_;
+    std::deque<ZeroCopySend> zerocopy_pending_;
+
+    size_t budget_bytes_;
+    int budget_requests_;
+    int requests_left_;        // 本轮还可以处理的请求数
+    bool read_pending_;        // 边缘触发下预算用完时套接字里可能还有数据
+    bool continue_scheduled_;
+
+    double idle_timeout_;
+    double header_read_timeout_;
+    bool reading_request_;  // 输入缓冲区里有不完整的请求, 使用请求头读取超时
+    int requests_;
+    event::TimingWheel::Entry timeout_entry_;
 };
     
 } // namespace connection
@@ -2,15 +2,16 @@
 
 #include "utils/uncopyable.h"
 #include "net/tcp_connection.h"
-#include "net/socket.h"
+#include "net/acceptor.h"
 #include "net/inet_address.h"
-#include "event/channel.h"
 #include "event/event_loop.h"
 #include "event/event_loop_thread_pool.h"
+#include "event/spsc_queue.h"
 
 #include <unordered_map>
 #include <memory>
 #include <atomic>
+#include <vector>
 
 namespace net {
 
@@ -21,8 +22,11 @@ public:
     enum Option {
         kNoReusePort,
         kReusePort,
+        kReusePortPerLoop,  // 每个 IO loop 一个 SO_REUSEPORT 监听套接字, 由内核分配连接, 在本线程 accept
     };
 
+    // addr 可以是 IPv4, IPv6 或 Unix 域套接字地址, 更多监听地址通过 AddListenAddress 添加
+
     TcpServer(event::EventLoop *loop,
               const InetAddress &addr,
               const std::string &name,
@@ -34,27 +38,110 @@ public:
     void SetMessageCallback(const MessageCallback &cb) { message_callback_ = cb; }
     void SetWriteCompleteCallback(const WriteCompleteCallback &cb) { write_complete_callback_ = cb; }
 
+    // 同时监听另一个地址, 所有地址上的连接共享 IO 线程和回调, 需要在 Start 之前调用
+    // kReusePortPerLoop 时 TCP 地址在每个 IO loop 上各有一个监听者; Unix 域套接字不支持 SO_REUSEPORT,
+    // 总是由 acceptor 所在的 loop 接受后交给 IO 线程
+    void AddListenAddress(const InetAddress &addr);
+
     void SetThreadNum(int num_threads);
+    // 新连接在 IO 线程间的分配策略, 默认轮询, 需要在 Start 之前设置
+    void SetLoadBalance(event::EventLoopThreadPool::Strategy strategy) { thread_pool_->SetStrategy(strategy); }
+    // IO 线程的 CPU 放置策略和 acceptor 绑定的 CPU, 需要在 Start 之前设置
+    void SetThreadPlacement(event::EventLoopThreadPool::Placement placement,
+                            const std::vector<int> &cpus = std::vector<int>()) {
+        thread_pool_->SetPlacement(placement, cpus);
+    }
+    void SetAcceptorCpu(int cpu) { thread_pool_->SetAcceptorCpu(cpu); }
+    // 仅 kReusePortPerLoop: 在监听套接字上设置 SO_INCOMING_CPU 并挂载按收包 CPU 选择监听者的 CBPF 程序,
+    // 让连接在处理网卡中断的核上被 accept; 需要 IO 线程各自绑定单个 CPU, 需要在 Start 之前设置
+    void SetCpuSteering(bool on) { cpu_steering_ = on; }
     void Start();
 
+    // 连接超时由各自 EventLoop 的时间轮管理, 单位秒, 0 表示不限制
+    void SetIdleTimeout(double seconds) { idle_timeout_ = seconds; }
+    void SetHeaderReadTimeout(double seconds) { header_read_timeout_ = seconds; }
+
+    // 新连接使用边缘触发模式
+    void SetEdgeTriggered(bool on) { edge_triggered_ = on; }
+    // 监听套接字和每个连接的套接字选项, 需要在 Start 之前设置
+    void SetSocketOptions(const SocketOptions &options) { socket_options_ = options; }
+    const SocketOptions& socket_options() const { return socket_options_; }
+    // 每个连接每轮事件循环的字节和请求预算, 见 TcpConnection::SetIoBudget; 0 表示不限制
+    void SetIoBudget(size_t bytes, int requests) { budget_bytes_ = bytes; budget_requests_ = requests; }
+
+    // 每隔 seconds 秒在日志中输出各 IO 线程的 EventLoop 统计, 0 表示不输出, 需要在 Start 之前设置
+    void SetStatsLogInterval(double seconds) { stats_log_interval_ = seconds; }
+    void LogLoopStats() const;
+
+    // IO 线程忙轮询预算 (微秒), 同时在新连接上设置 SO_BUSY_POLL; 0 表示关闭, 需要在 Start 之前设置
+    void SetBusyPoll(int usec) { busy_poll_us_ = usec; }
+
+    // 同时存在的连接数上限, 超过后新连接 accept 之后立即关闭; 0 表示不限制
+    void SetMaxConnections(int max_connections) { max_connections_ = max_connections; }
+    // 所有 loop 上的连接总数, 可以在任意线程调用
+    int num_connections() const { return num_connections_.load(std::memory_order_relaxed); }
+    // 因超过上限被拒绝的连接总数
+    uint64_t rejected_connections() const { return rejected_connections_.load(std::memory_order_relaxed); }
+
+    // 输出流控, 需要在 Start 之前设置: 单个连接的高低水位 (字节),
+    // 以及所有连接输出缓冲区的总字节数上限, 超过后有待发送数据的连接都暂停读取; 0 表示不限制
+    void SetWaterMarks(size_t high, size_t low) { high_water_mark_ = high; low_water_mark_ = low; }
+    void SetMaxOutputBytes(size_t max_bytes) { flow_control_->max_output_bytes = max_bytes; }
+    // 以下统计可以在任意线程调用
+    size_t output_bytes() const { return flow_control_->output_bytes.load(std::memory_order_relaxed); }
+    int paused_connections() const { return flow_control_->paused_connections.load(std::memory_order_relaxed); }
+    uint64_t pause_events() const { return flow_control_->pause_events.load(std::memory_order_relaxed); }
+
     std::string name() const { return name_; }
-    std::string ip_port() const { return addr_->GetIpPort(); }
+    // 第一个监听地址
+    std::string ip_port() const { return listen_addrs_[0].GetIpPort(); }
+    const std::vector<InetAddress>& listen_addrs() const { return listen_addrs_; }
 
 private:
     using ConnectionMap = std::unordered_map<int, std::shared_ptr<TcpConnection>>;
 
-    void HandleNewConnection();
-    void RemoveConnection(const TcpConnectionPtr &conn);
-    void RemoveConnectionInLoop(const TcpConnectionPtr &conn);
+    // acceptor 线程交给 IO 线程的新连接, TcpConnection 由 IO 线程自己创建
+    struct PendingConnection {
+        int fd;
+        InetAddress peer_addr;
+    };
+
+    // 每个处理连接的 loop 一份: 自己的连接表, 以及从 acceptor 线程接收新连接的交接队列
+    // 连接的建立和销毁都在所属 loop 线程内完成, 不经过其他线程
+    struct LoopContext {
+        event::EventLoop *loop;
+        ConnectionMap connections;                   // 只在 loop 线程访问
+        event::SpscQueue<PendingConnection> handoff;  // 单生产者单消费者, 一批 accept 结束后最多唤醒一次
+        std::atomic<bool> drain_scheduled;           // 已投递 DrainHandoff 且尚未开始执行
+        bool dirty;                                  // 只在 acceptor 线程访问, 本批次有新连接
+
+        LoopContext(event::EventLoop *owner, size_t capacity)
+                : loop(owner), handoff(capacity), drain_scheduled(false), dirty(false) {}
+    };
+
+    static const size_t kHandoffCapacity = 1024;
+
+    void StartPerLoopAcceptors();
+    void HandleNewConnection(int connfd, const InetAddress &peer_addr);
+    void FlushHandoffs();
+    void DrainHandoff(LoopContext *context);
+    bool AdmitConnection(LoopContext *context, int connfd);
+    void NewConnection(LoopContext *context, int connfd, const InetAddress &peer_addr);
+    void RejectConnection(int connfd);
+    void RemoveConnection(LoopContext *context, const TcpConnectionPtr &conn);
+    void CloseAllInLoop(LoopContext *context);
 
     event::EventLoop *loop_;
 
     const std::string name_;
-    const std::shared_ptr<InetAddress> addr_;
+    std::vector<InetAddress> listen_addrs_;
 
-    std::shared_ptr<Socket> accept_socket_;
-    std::shared_ptr<event::Channel> accept_channel_;
+    const Option option_;
+    std::vector<std::unique_ptr<Acceptor>> acceptors_;       // 运行在 loop_ 上
+    std::vector<std::unique_ptr<Acceptor>> loop_acceptors_;  // kReusePortPerLoop: 每个 TCP 地址在每个 IO loop 上一个
     std::shared_ptr<event::EventLoopThreadPool> thread_pool_;
+    std::vector<std::unique_ptr<LoopContext>> contexts_;  // 与 GetAllLoops 一一对应
+    std::unordered_map<event::EventLoop*, LoopContext*> context_map_;
 
     ConnectionCallback connection_callback_;
     MessageCallback message_callback_;
@@ -63,8 +150,24 @@ private:
 
     std::atomic_int started_;
 
-    int next_conn_id_;
-    ConnectionMap connection_map_;
+    double idle_timeout_;
+    double header_read_timeout_;
+    bool edge_triggered_;
+    SocketOptions socket_options_;
+    size_t budget_bytes_;
+    int budget_requests_;
+    int busy_poll_us_;
+    double stats_log_interval_;
+    bool cpu_steering_;
+    int max_connections_;
+    std::atomic_int num_connections_;
+    std::atomic<uint64_t> rejected_connections_;
+    size_t high_water_mark_;  // 0 表示使用 TcpConnection 的默认值
+    size_t low_water_mark_;
+    const std::shared_ptr<FlowControl> flow_control_;
+    std::atomic<bool> socket_busy_poll_;  // 套接字选项设置失败 (通常是权限不足) 后不再尝试
+
+    std::atomic_int next_conn_id_;
 };
 
 } // namespace net
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <vector>
+
+namespace thread {
+
+// 一个逻辑 CPU 在拓扑中的位置, 从 /sys/devices/system/cpu 读取
+struct CpuInfo {
+    int cpu;      // 逻辑 CPU 编号
+    int core;     // 物理核编号, 同一物理核上的超线程相同
+    int package;  // 物理封装 (socket) 编号
+    int node;     // NUMA 节点编号, 读不到时为 0
+};
+
+// 当前进程允许运行的 CPU (sched_getaffinity) 及其拓扑, 按 CPU 编号排序
+// sysfs 不可用时每个逻辑 CPU 视为一个独立的物理核
+std::vector<CpuInfo> GetCpuTopology();
+
+// 允许运行的物理核数量, 至少为 1
+int PhysicalCoreCount();
+
+// 每个物理核取一个逻辑 CPU, 按 NUMA 节点交替排列: node0, node1, node0, node1 ...
+// 依次取前 n 个即可让线程均匀分布在各节点且不共享物理核
+// exclude_cpu 所在的物理核不参与分配, -1 表示不排除
+std::vector<int> SpreadCpus(int exclude_cpu = -1);
+
+// 把调用线程绑定到 cpus 中的 CPU 上, 失败返回 false
+bool SetCurrentThreadAffinity(const std::vector<int> &cpus);
+
+} // namespace thread
@@ -10,6 +10,7 @@
 #include <thread>
 #include <atomic>
 #include <mutex>
+#include <vector>
 
 namespace current_thread {
 
@@ -34,10 +35,17 @@ public:
     explicit Thread(const ThreadFunc &func, const std::string &name = std::string());
     ~Thread();
 
+    // 线程启动时先绑定到这些 CPU 再执行 func, 线程内分配的内存也就落在对应的 NUMA 节点上
+    // 需要在 Start 之前设置, 为空表示不绑定
+    void SetCpuAffinity(const std::vector<int> &cpus) { cpus_ = cpus; }
+    const std::vector<int>& cpu_affinity() const { return cpus_; }
+
     void Start();
     void Join();
 
     bool is_started() const { return is_started_; }
+    // Start 之后可用, 绑定失败 (例如 CPU 不在进程允许的集合中) 时为 false
+    bool affinity_applied() const { return affinity_applied_; }
     std::thread::id thread_id() const { return thread_id_; }
     std::string name() const { return name_; }
 
@@ -46,6 +54,8 @@ private:
     std::thread thread_;
     ThreadFunc func_;
     std::string name_;
+    std::vector<int> cpus_;
+    bool affinity_applied_;
     bool is_started_;
     bool is_joined_;
     std::once_flag flag_;
@@ -4,6 +4,7 @@
 #include "log/logger.h"
 #include "memory/memory_pool.h"
 #include "cache/lfu_cache.h"
+#include "thread/cpu_topology.h"
 
 int main() {
     logging::Logger::SetLogFileName("./webserver.log");
@@ -14,7 +15,15 @@ int main() {
     net::InetAddress addr(5000);
     http::HttpServer http_server(&loop, addr);
 
-    http_server.SetThreadNum(3);
+    // 每个物理核一个 EventLoop: acceptor 独占第一个核, 其余每核一个 IO 线程
+    // 只有一个核时由 acceptor 所在的 loop 直接处理连接
+    int cores = thread::PhysicalCoreCount();
+    if (cores > 1) {
+        std::vector<int> cpus = thread::SpreadCpus();
+        http_server.SetAcceptorCpu(cpus[0]);
+        http_server.SetThreadPlacement(event::EventLoopThreadPool::kSpreadNuma);
+    }
+    http_server.SetThreadNum(cores - 1);
     http_server.Start();
     loop.Loop();
     return 0;
@@ -45,13 +45,14 @@ void KeyList::Remove(KeyNode *node) {
 }
 
 LfuCache::~LfuCache() {
-    for (auto &pair : key_table_) {
-        DeleteElement(pair.second);
+    // KeyNode 归各自频率链表所有, 随 FreqNode 一起释放; 多个 key 可能指向同一个 FreqNode,
+    // 所以沿链表逐个释放, 不能遍历 key_table_ / freq_table_
+    FreqNode *node = dummy_head_;
+    while (node != nullptr) {
+        FreqNode *next = node->next();
+        DeleteElement(node);
+        node = next;
     }
-    for (auto &pair : freq_table_) {
-        DeleteElement(pair.second);
-    }
-    DeleteElement(dummy_head_);
 }
 
 void LfuCache::Init(size_t capacity) {
@@ -65,11 +66,18 @@ LfuCache& LfuCache::instance() {
     return cache;
 }
 
-void LfuCache::Set(const std::string &key, const std::string &value) {
+void LfuCache::Set(const std::string &key, const net::BlobPtr &value) {
     if (!capacity_) return;
 
     std::lock_guard<std::mutex> lock(mutex_);
 
+    // 多个线程可能同时未命中并写入同一个 key, 只更新值, 否则旧节点会留在链表里
+    auto existing = key_table_.find(key);
+    if (existing != key_table_.end()) {
+        existing->second->data().value_ = value;
+        return;
+    }
+
     if (key_table_.size() == capacity_) {
         auto min_freq_list = dummy_head_->next();
         auto min_freq_node = min_freq_list->data().back();
@@ -89,7 +97,7 @@ void LfuCache::Set(const std::string &key, const std::string &value) {
     key_table_[key] = key_node;
 }
 
-bool LfuCache::Get(const std::string &key, std::string &value) {
+bool LfuCache::Get(const std::string &key, net::BlobPtr &value) {
     if (!capacity_) return false;
 
     std::lock_guard<std::mutex> lock(mutex_);
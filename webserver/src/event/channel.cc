@@ -8,9 +8,15 @@ namespace event {
 const int Channel::kNoneEvent = 0;
 const int Channel::kReadEvent = EPOLLIN | EPOLLPRI;
 const int Channel::kWriteEvent = EPOLLOUT;
+const int Channel::kEdgeEvent = EPOLLET;
 
 Channel::Channel(EventLoop *loop, int fd)
-        : loop_(loop), fd_(fd), events_(0), revents_(0), holded_(false) {}
+        : loop_(loop),
+          fd_(fd),
+          events_(0),
+          revents_(0),
+          edge_triggered_(false),
+          holded_(false) {}
 
 Channel::~Channel() {}
 
@@ -34,11 +40,13 @@ void Channel::HandleEventsWithGuard() {
         if (error_callback_) error_callback_();
     }
 
-    if (revents_ & (EPOLLIN | EPOLLPRI | EPOLLRDHUP)) {
+    // 读事件已取消 (例如连接暂停读取) 时, 本轮 epoll 已经返回的可读事件也不再分发
+    if ((revents_ & (EPOLLIN | EPOLLPRI | EPOLLRDHUP)) && IsReading()) {
         if (read_callback_) read_callback_();
     }
 
-    if (revents_ & EPOLLOUT) {
+    // 前面的回调可能已经取消了写事件, 例如连接已关闭, 这时不再分发
+    if ((revents_ & EPOLLOUT) && IsWriting()) {
         if (write_callback_) write_callback_();
     }
 }
@@ -22,14 +22,16 @@ Epoller::~Epoller() {
     ::close(epoll_fd_);
 }
 
-void Epoller::Poll(ChannelList &active_channels) {
-    int num_events = epoll_wait(epoll_fd_, &*ready_events_.begin(), ready_events_.size(), kEpollTimeOut);
+void Epoller::Poll(ChannelList &active_channels, int timeout_ms) {
+    ApplyUpdates();
 
-    if (num_events < 0 && errno != EINTR) {
-        LOG_ERROR << "epoll wait error: " << errno;
-        return;
-    } else if (num_events == 0) {
-        LOG_ERROR << "epoll wait timeout";
+    int num_events = epoll_wait(epoll_fd_, &*ready_events_.begin(), ready_events_.size(), timeout_ms);
+
+    // 超时是正常情况, 定时任务由 timerfd 驱动
+    if (num_events < 0) {
+        if (errno != EINTR) {
+            LOG_ERROR << "epoll wait error: " << errno;
+        }
         return;
     }
 
@@ -39,43 +41,62 @@ void Epoller::Poll(ChannelList &active_channels) {
         active_channels.push_back(channel);
     }
 
-    if (num_events == ready_events_.size()) {
+    if (static_cast<size_t>(num_events) == ready_events_.size()) {
         ready_events_.resize(ready_events_.size() * 2);
     }
 }
 
 bool Epoller::HasChannel(Channel *channel) const {
-    auto it = channel_map_.find(channel->fd());
-    return it != channel_map_.end() && it->second == channel;
+    int fd = channel->fd();
+    return fd >= 0 && static_cast<size_t>(fd) < entries_.size() && entries_[fd].channel == channel;
 }
 
-void Epoller::UpdateChannel(Channel *channel, int timeout) {
+void Epoller::UpdateChannel(Channel *channel) {
     int fd = channel->fd();
-    if (channel_map_.find(fd) == channel_map_.end()) {
-        channel_map_[fd] = channel;
-        Update(EPOLL_CTL_ADD, channel);
-    } else {
-        if (channel->IsNoneEvent()) {
-            Update(EPOLL_CTL_DEL, channel);
-            channel_map_.erase(fd);
-        } else {
-            Update(EPOLL_CTL_MOD, channel);
-        }
+    Entry empty = { nullptr, 0, false };
+    GrowForFd(entries_, fd, empty);
+    Entry &entry = entries_[fd];
+    entry.channel = channel;
+    if (!entry.dirty) {
+        entry.dirty = true;
+        dirty_fds_.push_back(fd);
     }
 }
 
 void Epoller::RemoveChannel(Channel *channel) {
+    if (!HasChannel(channel)) return;
     int fd = channel->fd();
-    if (channel_map_.find(fd) != channel_map_.end()) {
-        Update(EPOLL_CTL_DEL, channel);
-        channel_map_.erase(fd);
+    Entry &entry = entries_[fd];
+    if (entry.registered) {
+        Update(EPOLL_CTL_DEL, channel, 0);
+    }
+    // 仍在 dirty_fds_ 中的话, ApplyUpdates 会跳过
+    entry.channel = nullptr;
+    entry.registered = 0;
+}
+
+void Epoller::ApplyUpdates() {
+    for (int fd : dirty_fds_) {
+        Entry &entry = entries_[fd];
+        entry.dirty = false;
+        if (!entry.channel) continue;
+
+        uint32_t events = static_cast<uint32_t>(entry.channel->events());
+        if (events == entry.registered) continue;
+
+        int operation = events == 0 ? EPOLL_CTL_DEL
+                        : entry.registered ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+        if (Update(operation, entry.channel, events)) {
+            entry.registered = events;
+        }
     }
+    dirty_fds_.clear();
 }
 
-void Epoller::Update(int operation, Channel *channel) {
+bool Epoller::Update(int operation, Channel *channel, uint32_t events) {
     epoll_event event;
     bzero(&event, sizeof(event));
-    event.events = channel->events();
+    event.events = events;
     event.data.ptr = channel;
     int fd = channel->fd();
 
@@ -87,7 +108,9 @@ void Epoller::Update(int operation, Channel *channel) {
         } else {
             LOG_ERROR << "epoll_ctl del error: " << strerror(errno);
         }
+        return false;
     }
+    return true;
 }
 
 } // namespace event
@@ -1,10 +1,14 @@
 #include "event/event_loop.h"
 #include "event/channel.h"
-#include "event/epoller.h"
+#include "event/poller.h"
+#include "event/timer_queue.h"
+#include "event/timing_wheel.h"
 #include "thread/thread.h"
 #include "log/logger.h"
 
 #include <iostream>
+#include <condition_variable>
+#include <mutex>
 #include <unistd.h>
 #include <sys/eventfd.h>
 #include <fcntl.h>
@@ -25,12 +29,24 @@ EventLoop::EventLoop()
         : thread_id_(current_thread::tid()),
           wakeup_fd_(CreateEventFd()),
           wakeup_channel_(new Channel(this, wakeup_fd_)),
-          epoller_(new Epoller()),
+          poller_(Poller::NewDefaultPoller()),
+          timer_queue_(new TimerQueue(this)),
+          timing_wheel_(new TimingWheel(this)),
+          pending_count_(0),
+          wakeup_pending_(false),
+          wakeup_count_(0),
+          connection_count_(0),
+          lag_us_(0),
+          lag_probe_time_(0),
+          busy_poll_us_(0),
+          spinning_(false),
+          last_active_time_(0),
           is_looping_(false),
           is_quit_(false),
           is_handling_(false),
           is_calling_pending_functions_(false) {
-    LOG_INFO << "EventLoop created " << this << " in thread " << thread_id_;
+    LOG_INFO << "EventLoop created " << this << " in thread " << thread_id_
+             << " using " << poller_->name();
     if (t_loop_in_this_thread) {
         LOG_FATAL << "Another EventLoop " << t_loop_in_this_thread
                   << " exists in this thread " << thread_id_;
@@ -42,9 +58,9 @@ EventLoop::EventLoop()
 }
 
 EventLoop::~EventLoop() {
-    ::close(wakeup_fd_);
     wakeup_channel_->DisableAll();
     wakeup_channel_->Remove();
+    ::close(wakeup_fd_);
     t_loop_in_this_thread = nullptr;
 }
 
@@ -54,10 +70,23 @@ void EventLoop::Loop() {
 
     while (!is_quit_) {
         active_channels_.clear();
-        epoller_->Poll(active_channels_);
+        int64_t start = NowNanoseconds();
+        poller_->Poll(active_channels_, PollTimeout());
+        int64_t now = NowNanoseconds();
+        stats_.AddIteration();
+        stats_.poll_wait.Record(now - start);
+        stats_.events.Record(active_channels_.size());
+
+        if (!active_channels_.empty() && busy_poll_us_ > 0) {
+            last_active_time_ = now / 1000;
+        }
         for (auto &channel : active_channels_) {
             channel->HandleEvents();
+            int64_t end = NowNanoseconds();
+            stats_.handle.Record(end - now);
+            now = end;
         }
+        PerformReadyFunctions();
         PerformPendingFunctions();
     }
 
@@ -79,18 +108,76 @@ void EventLoop::RunInLoop(const Function &func) {
     }
 }
 
-void EventLoop::QueueInLoop(const Function &func) {
-    {
-        std::unique_lock<std::mutex> lock(mutex_);
-        pending_functions_.emplace_back(func);
+void EventLoop::RunInLoopAndWait(const Function &func) {
+    if (is_in_loop_thread()) {
+        func();
+        return;
     }
+    std::mutex mutex;
+    std::condition_variable cond;
+    bool done = false;
+    QueueInLoop([&]() {
+        func();
+        std::lock_guard<std::mutex> lock(mutex);
+        done = true;
+        cond.notify_one();
+    });
+    std::unique_lock<std::mutex> lock(mutex);
+    cond.wait(lock, [&]() { return done; });
+}
 
-    if (!is_in_loop_thread() || is_calling_pending_functions_) {
+void EventLoop::QueueInLoop(const Function &func) {
+    pending_functions_.Push(func);
+    pending_count_.fetch_add(1);
+
+    // 只有 loop 清除标志之后的第一次入队需要写 eventfd; loop 忙轮询时会自己发现新任务
+    if ((!is_in_loop_thread() || is_calling_pending_functions_)
+            && !spinning_.load()
+            && !wakeup_pending_.exchange(true, std::memory_order_acq_rel)) {
         Wakeup();
     }
 }
 
+TimerId EventLoop::RunAt(int64_t time, const TimerCallback &cb) {
+    return timer_queue_->AddTimer(cb, time, 0);
+}
+
+TimerId EventLoop::RunAfter(double delay, const TimerCallback &cb) {
+    int64_t time = NowMicroseconds() + static_cast<int64_t>(delay * 1000000);
+    return RunAt(time, cb);
+}
+
+TimerId EventLoop::RunEvery(double interval, const TimerCallback &cb) {
+    int64_t delta = static_cast<int64_t>(interval * 1000000);
+    return timer_queue_->AddTimer(cb, NowMicroseconds() + delta, delta);
+}
+
+void EventLoop::Cancel(TimerId timer_id) {
+    timer_queue_->Cancel(timer_id);
+}
+
+int64_t EventLoop::lag() const {
+    int64_t lag = lag_us_.load(std::memory_order_relaxed);
+    int64_t sent = lag_probe_time_.load(std::memory_order_relaxed);
+    if (sent != 0) {
+        int64_t waiting = NowMicroseconds() - sent;
+        if (waiting > lag) lag = waiting;
+    }
+    return lag;
+}
+
+void EventLoop::ProbeLag() {
+    if (lag_probe_time_.load(std::memory_order_relaxed) != 0) return;
+    int64_t sent = NowMicroseconds();
+    lag_probe_time_.store(sent, std::memory_order_relaxed);
+    QueueInLoop([this, sent]() {
+        lag_us_.store(NowMicroseconds() - sent, std::memory_order_relaxed);
+        lag_probe_time_.store(0, std::memory_order_relaxed);
+    });
+}
+
 void EventLoop::Wakeup() {
+    wakeup_count_.fetch_add(1, std::memory_order_relaxed);
     uint64_t one = 1;
     ssize_t n = write(wakeup_fd_, &one, sizeof(one));
     if (n != sizeof(one)) {
@@ -106,18 +193,52 @@ void EventLoop::HandleRead() {
     }
 }
 
-void EventLoop::PerformPendingFunctions() {
-    std::vector<Function> functions;
-    is_calling_pending_functions_ = true;
+int EventLoop::PollTimeout() {
+    // 还有没做完的工作, 只检查新事件, 不等待
+    if (!ready_functions_.empty()) return 0;
 
-    {
-        std::unique_lock<std::mutex> lock(mutex_);
-        functions.swap(pending_functions_);
+    const int budget = busy_poll_us_.load(std::memory_order_relaxed);
+    if (budget > 0 && NowMicroseconds() - last_active_time_ < budget) {
+        spinning_.store(true);
+        return 0;
     }
+    if (!spinning_.load(std::memory_order_relaxed)) return Poller::kPollTimeOut;
 
-    for (const Function &func : functions) {
+    // 退出忙轮询: 先清除标志再检查任务数, 与 QueueInLoop 的入队顺序相反, 两边至少有一方能看到对方
+    spinning_.store(false);
+    return pending_count_.load() > 0 ? 0 : Poller::kPollTimeOut;
+}
+
+void EventLoop::PerformReadyFunctions() {
+    stats_.ready_depth.Record(ready_functions_.size());
+    if (ready_functions_.empty()) return;
+    running_ready_functions_.swap(ready_functions_);
+    for (auto &func : running_ready_functions_) {
         func();
     }
+    running_ready_functions_.clear();
+    if (busy_poll_us_ > 0) last_active_time_ = NowMicroseconds();
+}
+
+void EventLoop::PerformPendingFunctions() {
+    is_calling_pending_functions_ = true;
+    // 先清除标志再取任务, 之后入队的任务会重新唤醒, 不会丢失
+    wakeup_pending_.exchange(false, std::memory_order_acq_rel);
+
+    // 只执行已经入队的任务, 执行过程中新入队的留到下一轮, 避免饿死 IO
+    size_t count = pending_count_.load(std::memory_order_acquire);
+    stats_.pending_depth.Record(count);
+    if (count > 0) {
+        int64_t start = NowNanoseconds();
+        Function func;
+        for (size_t i = 0; i < count && pending_functions_.Pop(&func); ++i) {
+            func();
+        }
+        pending_count_.fetch_sub(count, std::memory_order_release);
+        int64_t end = NowNanoseconds();
+        stats_.pending_time.Record(end - start);
+        if (busy_poll_us_ > 0) last_active_time_ = end / 1000;
+    }
     is_calling_pending_functions_ = false;
 }
 
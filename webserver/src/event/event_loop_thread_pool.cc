@@ -2,20 +2,43 @@
 #include "event/event_loop_thread.h"
 #include "event/event_loop.h"
 #include "log/logger.h"
+#include "thread/cpu_topology.h"
+
+#include <algorithm>
 
 namespace event {
 
+namespace {
+
+// splitmix64 终结函数, 把 key 打散到整个 64 位空间
+uint64_t Mix(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+} // namespace
+
 EventLoopThreadPool::EventLoopThreadPool(EventLoop *main_loop)
         : main_loop_(main_loop),
           is_started_(false),
           num_threads_(0),
-          next_(0) {
+          next_(0),
+          strategy_(kRoundRobin),
+          placement_(kNoAffinity),
+          placement_cpus_(),
+          acceptor_cpu_(-1),
+          random_state_(0x9e3779b97f4a7c15ULL) {
     if (num_threads_ < 0) {
         LOG_ERROR << "Cannot create EventLoopThreadPool with " << num_threads_ << " threads";
     }
 }
 
 EventLoopThreadPool::~EventLoopThreadPool() {
+    if (lag_probe_timer_.valid()) main_loop_->Cancel(lag_probe_timer_);
 }
 
 void EventLoopThreadPool::SetThreadNum(int num_threads) {
@@ -27,25 +50,175 @@ void EventLoopThreadPool::SetThreadNum(int num_threads) {
 void EventLoopThreadPool::Start(const ThreadInitCallback &cb) {
     is_started_ = true;
 
+    if (acceptor_cpu_ >= 0) {
+        int cpu = acceptor_cpu_;
+        main_loop_->RunInLoop([cpu]() {
+            if (thread::SetCurrentThreadAffinity(std::vector<int>(1, cpu))) {
+                LOG_INFO << "Acceptor loop pinned to cpu " << cpu;
+            } else {
+                LOG_WARN << "Failed to pin acceptor loop to cpu " << cpu;
+            }
+        });
+    }
+
     if (num_threads_ == 0) {
         if (cb) cb(main_loop_);
         return;
     }
 
+    std::vector<int> spread;
+    if (placement_ == kSpreadNuma) {
+        spread = thread::SpreadCpus(acceptor_cpu_);
+        if (static_cast<int>(spread.size()) < num_threads_) {
+            LOG_WARN << "EventLoopThreadPool: " << num_threads_ << " threads on "
+                     << spread.size() << " physical cores, some cores are shared";
+        }
+    }
+
     for (int i = 0; i < num_threads_; ++i) {
         EventLoopThread *thread = new EventLoopThread(cb);
+        std::vector<int> cpus = CpusForThread(i, spread);
+        thread->SetCpuAffinity(cpus);
         sub_loop_threads_.push_back(std::unique_ptr<EventLoopThread>(thread));
         sub_loops_.push_back(thread->StartLoop());
+        if (!cpus.empty() && !thread->affinity_applied()) {
+            LOG_WARN << "EventLoopThreadPool: failed to set cpu affinity of thread " << i;
+            cpus.clear();
+        }
+        sub_loop_cpus_.push_back(cpus.size() == 1 ? cpus[0] : -1);
+    }
+
+    if (strategy_ == kConsistentHash) {
+        for (size_t i = 0; i < sub_loops_.size(); ++i) {
+            for (int j = 0; j < kVirtualNodes; ++j) {
+                hash_ring_.emplace_back(Mix(i * kVirtualNodes + j), i);
+            }
+        }
+        std::sort(hash_ring_.begin(), hash_ring_.end());
+    } else if (strategy_ == kLeastLag || strategy_ == kPowerOfTwoChoices) {
+        lag_probe_timer_ = main_loop_->RunEvery(kLagProbeIntervalMs / 1000.0,
+                                                std::bind(&EventLoopThreadPool::ProbeLag, this));
+    }
+}
+
+std::vector<EventLoop*> EventLoopThreadPool::GetAllLoops() const {
+    if (sub_loops_.empty()) {
+        return std::vector<EventLoop*>(1, main_loop_);
+    }
+    return sub_loops_;
+}
+
+std::vector<int> EventLoopThreadPool::GetLoopCpus() const {
+    if (sub_loops_.empty()) {
+        return std::vector<int>(1, acceptor_cpu_);
+    }
+    return sub_loop_cpus_;
+}
+
+EventLoop* EventLoopThreadPool::GetNextLoop(uint64_t key) {
+    if (sub_loops_.empty()) return main_loop_;
+
+    size_t index = 0;
+    switch (strategy_) {
+        case kLeastConnections:
+            index = LeastConnections();
+            break;
+        case kLeastLag:
+            index = LeastLag();
+            break;
+        case kPowerOfTwoChoices:
+            index = PowerOfTwoChoices();
+            break;
+        case kConsistentHash:
+            index = ConsistentHash(key);
+            break;
+        default:
+            index = NextRoundRobin();
+            break;
+    }
+    return sub_loops_[index];
+}
+
+size_t EventLoopThreadPool::NextRoundRobin() {
+    size_t index = next_;
+    next_ = (next_ + 1) % sub_loops_.size();
+    return index;
+}
+
+size_t EventLoopThreadPool::LeastConnections() {
+    // 从轮询位置开始扫描, 连接数相同时不会总是选中第一个
+    size_t start = NextRoundRobin();
+    size_t best = start;
+    for (size_t i = 1; i < sub_loops_.size(); ++i) {
+        size_t index = (start + i) % sub_loops_.size();
+        if (sub_loops_[index]->connection_count() < sub_loops_[best]->connection_count()) {
+            best = index;
+        }
+    }
+    return best;
+}
+
+size_t EventLoopThreadPool::LeastLag() {
+    // 延迟按 kLagResolutionUs 取整, 差别在噪声范围内时比较连接数,
+    // 否则两次探测之间的新连接会全部涌向同一个 loop
+    size_t start = NextRoundRobin();
+    size_t best = start;
+    int64_t best_lag = sub_loops_[best]->lag() / kLagResolutionUs;
+    for (size_t i = 1; i < sub_loops_.size(); ++i) {
+        size_t index = (start + i) % sub_loops_.size();
+        int64_t lag = sub_loops_[index]->lag() / kLagResolutionUs;
+        if (lag < best_lag || (lag == best_lag
+                && sub_loops_[index]->connection_count() < sub_loops_[best]->connection_count())) {
+            best = index;
+            best_lag = lag;
+        }
+    }
+    return best;
+}
+
+size_t EventLoopThreadPool::PowerOfTwoChoices() {
+    const size_t n = sub_loops_.size();
+    if (n == 1) return 0;
+    // xorshift64, 只在 acceptor 线程调用
+    random_state_ ^= random_state_ << 13;
+    random_state_ ^= random_state_ >> 7;
+    random_state_ ^= random_state_ << 17;
+    size_t a = random_state_ % n;
+    size_t b = (a + 1 + (random_state_ >> 32) % (n - 1)) % n;
+
+    int conn_a = sub_loops_[a]->connection_count();
+    int conn_b = sub_loops_[b]->connection_count();
+    if (conn_a != conn_b) return conn_a < conn_b ? a : b;
+    return sub_loops_[a]->lag() <= sub_loops_[b]->lag() ? a : b;
+}
+
+size_t EventLoopThreadPool::ConsistentHash(uint64_t key) const {
+    auto it = std::lower_bound(hash_ring_.begin(), hash_ring_.end(),
+                               std::make_pair(Mix(key), static_cast<size_t>(0)));
+    if (it == hash_ring_.end()) it = hash_ring_.begin();
+    return it->second;
+}
+
+std::vector<int> EventLoopThreadPool::CpusForThread(int index, const std::vector<int> &spread) const {
+    switch (placement_) {
+        case kPinCpus:
+            if (placement_cpus_.empty()) break;
+            return std::vector<int>(1, placement_cpus_[index % placement_cpus_.size()]);
+        case kCpuSet:
+            return placement_cpus_;
+        case kSpreadNuma:
+            if (spread.empty()) break;
+            return std::vector<int>(1, spread[index % spread.size()]);
+        default:
+            break;
     }
+    return std::vector<int>();
 }
 
-EventLoop* EventLoopThreadPool::GetNextLoop() {
-    EventLoop *loop = main_loop_;
-    if (!sub_loops_.empty()) {
-        loop = sub_loops_[next_];
-        next_ = (next_ + 1) % num_threads_;
+void EventLoopThreadPool::ProbeLag() {
+    for (EventLoop *loop : sub_loops_) {
+        loop->ProbeLag();
     }
-    return loop;
 }
 
     
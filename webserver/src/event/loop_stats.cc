@@ -0,0 +1,88 @@
+#include "event/loop_stats.h"
+
+#include <stdio.h>
+
+namespace event {
+
+const int Histogram::kNumBuckets;
+
+Histogram::Histogram()
+        : count_(0),
+          sum_(0),
+          max_(0) {
+    for (int i = 0; i < kNumBuckets; ++i) {
+        buckets_[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+int Histogram::BucketIndex(uint64_t value) {
+    if (value < static_cast<uint64_t>(kSubBuckets)) return static_cast<int>(value);
+    int msb = 63 - __builtin_clzll(value);
+    int shift = msb - kSubBucketBits;
+    return (shift + 1) * kSubBuckets + static_cast<int>((value >> shift) & (kSubBuckets - 1));
+}
+
+uint64_t Histogram::BucketUpperBound(int index) {
+    if (index < kSubBuckets) return index;
+    int shift = index / kSubBuckets - 1;
+    uint64_t sub = index % kSubBuckets;
+    uint64_t lower = (kSubBuckets + sub) << shift;
+    return lower + (1ULL << shift) - 1;
+}
+
+Histogram::Snapshot Histogram::GetSnapshot() const {
+    Snapshot snapshot;
+    snapshot.buckets.resize(kNumBuckets);
+    uint64_t total = 0;
+    for (int i = 0; i < kNumBuckets; ++i) {
+        snapshot.buckets[i] = buckets_[i].load(std::memory_order_relaxed);
+        total += snapshot.buckets[i];
+    }
+    // 读取期间可能有新的记录, 以桶的总和为准保证分位数一致
+    snapshot.count = total;
+    snapshot.sum = sum_.load(std::memory_order_relaxed);
+    snapshot.max = max_.load(std::memory_order_relaxed);
+    return snapshot;
+}
+
+uint64_t Histogram::Snapshot::Percentile(double p) const {
+    if (count == 0) return 0;
+    uint64_t rank = static_cast<uint64_t>(p / 100 * count);
+    if (rank >= count) rank = count - 1;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < buckets.size(); ++i) {
+        seen += buckets[i];
+        if (seen > rank) {
+            uint64_t upper = BucketUpperBound(static_cast<int>(i));
+            return upper < max ? upper : max;
+        }
+    }
+    return max;
+}
+
+namespace {
+
+void AppendHistogram(std::string &out, const char *name, const Histogram &histogram, double scale, const char *unit) {
+    Histogram::Snapshot s = histogram.GetSnapshot();
+    char buf[160];
+    snprintf(buf, sizeof(buf), " %s[n=%llu avg=%.1f%s p50=%.1f%s p99=%.1f%s max=%.1f%s]",
+             name, static_cast<unsigned long long>(s.count),
+             s.Mean() / scale, unit, s.Percentile(50) / scale, unit,
+             s.Percentile(99) / scale, unit, s.max / scale, unit);
+    out.append(buf);
+}
+
+} // namespace
+
+std::string LoopStats::ToString() const {
+    std::string out = "iterations=" + std::to_string(iterations.load(std::memory_order_relaxed));
+    AppendHistogram(out, "poll_wait", poll_wait, 1000, "us");
+    AppendHistogram(out, "events", events, 1, "");
+    AppendHistogram(out, "handle", handle, 1000, "us");
+    AppendHistogram(out, "pending_depth", pending_depth, 1, "");
+    AppendHistogram(out, "pending_time", pending_time, 1000, "us");
+    AppendHistogram(out, "ready_depth", ready_depth, 1, "");
+    return out;
+}
+
+} // namespace event
@@ -0,0 +1,21 @@
+#include "event/poller.h"
+#include "event/epoller.h"
+#include "event/uring_poller.h"
+#include "log/logger.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+namespace event {
+
+Poller* Poller::NewDefaultPoller() {
+    const char *backend = ::getenv("WEBSERVER_POLLER");
+    if (backend && strcmp(backend, "io_uring") == 0) {
+        Poller *poller = UringPoller::Create();
+        if (poller) return poller;
+        LOG_WARN << "io_uring is not supported, fall back to epoll";
+    }
+    return new Epoller();
+}
+
+} // namespace event
@@ -0,0 +1,106 @@
+#include "event/task_queue.h"
+
+#include <sched.h>
+
+namespace event {
+
+namespace {
+
+template <typename Node>
+void DeleteList(Node *node) {
+    while (node) {
+        Node *next = node->next.load(std::memory_order_relaxed);
+        delete node;
+        node = next;
+    }
+}
+
+} // namespace
+
+thread_local TaskQueue::NodeCache TaskQueue::t_node_cache_;
+
+TaskQueue::NodeCache::~NodeCache() {
+    DeleteList(head);
+}
+
+TaskQueue::TaskQueue()
+        : head_(&stub_),
+          tail_(&stub_),
+          free_(nullptr) {
+    stub_.next.store(nullptr, std::memory_order_relaxed);
+}
+
+TaskQueue::~TaskQueue() {
+    Function func;
+    while (Pop(&func)) {}
+    DeleteList(free_.exchange(nullptr, std::memory_order_acquire));
+}
+
+void TaskQueue::Push(const Function &func) {
+    Node *node = NewNode();
+    node->func = func;
+    PushNode(node);
+}
+
+TaskQueue::Node* TaskQueue::NewNode() {
+    NodeCache &cache = t_node_cache_;
+    if (cache.head == nullptr) {
+        // 一次取走全部回收的节点, 只有整体 exchange 没有逐个弹出, 不存在 ABA 问题
+        cache.head = free_.exchange(nullptr, std::memory_order_acquire);
+    }
+    Node *node = cache.head;
+    if (node == nullptr) return new Node;
+    cache.head = node->next.load(std::memory_order_relaxed);
+    return node;
+}
+
+void TaskQueue::RecycleNode(Node *node) {
+    Node *top = free_.load(std::memory_order_relaxed);
+    do {
+        node->next.store(top, std::memory_order_relaxed);
+    } while (!free_.compare_exchange_weak(top, node, std::memory_order_release, std::memory_order_relaxed));
+}
+
+void TaskQueue::PushNode(Node *node) {
+    node->next.store(nullptr, std::memory_order_relaxed);
+    Node *prev = head_.exchange(node, std::memory_order_acq_rel);
+    // exchange 和这里的 store 之间, 队列处于断开状态, 由 Pop 自旋等待
+    prev->next.store(node, std::memory_order_release);
+}
+
+bool TaskQueue::Pop(Function *func) {
+    Node *tail = tail_;
+    Node *next = tail->next.load(std::memory_order_acquire);
+
+    if (tail == &stub_) {
+        if (next == nullptr) {
+            if (head_.load(std::memory_order_acquire) == &stub_) return false;
+            // 有生产者已经 exchange 但还没有链接上
+            while ((next = tail->next.load(std::memory_order_acquire)) == nullptr) {
+                sched_yield();
+            }
+        }
+        tail_ = next;
+        tail = next;
+        next = tail->next.load(std::memory_order_acquire);
+    }
+
+    if (next == nullptr) {
+        if (tail == head_.load(std::memory_order_acquire)) {
+            // tail 是最后一个节点, 放回 stub 使其可以出队
+            PushNode(&stub_);
+        }
+        while ((next = tail->next.load(std::memory_order_acquire)) == nullptr) {
+            sched_yield();
+        }
+    }
+
+    tail_ = next;
+    func->swap(tail->func);
+    // 换出来的是调用者上一个任务, 在这里析构, 不能随节点留到下次复用
+    tail->func = nullptr;
+    RecycleNode(tail);
+    return true;
+}
+
+} // namespace event
@@ -0,0 +1,155 @@
+#include "event/timer_queue.h"
+#include "event/event_loop.h"
+#include "log/logger.h"
+
+#include <strings.h>
+#include <sys/timerfd.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace event {
+
+std::atomic<int64_t> Timer::num_created_(0);
+
+int64_t NowMicroseconds() {
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return static_cast<int64_t>(now.tv_sec) * 1000000 + now.tv_nsec / 1000;
+}
+
+static int CreateTimerFd() {
+    int timer_fd = ::timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (timer_fd < 0) {
+        LOG_FATAL << "timerfd create error: " << errno;
+    }
+    return timer_fd;
+}
+
+static void ResetTimerFd(int timer_fd, int64_t expiration) {
+    int64_t microseconds = expiration - NowMicroseconds();
+    if (microseconds < 100) microseconds = 100;
+
+    itimerspec new_value;
+    itimerspec old_value;
+    bzero(&new_value, sizeof(new_value));
+    bzero(&old_value, sizeof(old_value));
+    new_value.it_value.tv_sec = static_cast<time_t>(microseconds / 1000000);
+    new_value.it_value.tv_nsec = static_cast<long>((microseconds % 1000000) * 1000);
+    if (::timerfd_settime(timer_fd, 0, &new_value, &old_value) < 0) {
+        LOG_ERROR << "timerfd_settime error: " << errno;
+    }
+}
+
+static void ReadTimerFd(int timer_fd) {
+    uint64_t howmany;
+    ssize_t n = ::read(timer_fd, &howmany, sizeof(howmany));
+    if (n != sizeof(howmany)) {
+        LOG_ERROR << "TimerQueue::HandleRead() reads " << n << " bytes instead of 8";
+    }
+}
+
+TimerQueue::TimerQueue(EventLoop *loop)
+        : loop_(loop),
+          timer_fd_(CreateTimerFd()),
+          timer_channel_(loop, timer_fd_),
+          calling_expired_timers_(false) {
+    timer_channel_.SetReadCallback(std::bind(&TimerQueue::HandleRead, this));
+    timer_channel_.EnableReading();
+}
+
+TimerQueue::~TimerQueue() {
+    timer_channel_.DisableAll();
+    timer_channel_.Remove();
+    ::close(timer_fd_);
+    for (const Entry &timer : timers_) {
+        delete timer.second;
+    }
+}
+
+TimerId TimerQueue::AddTimer(const TimerCallback &cb, int64_t when, int64_t interval) {
+    Timer *timer = new Timer(cb, when, interval);
+    loop_->RunInLoop(std::bind(&TimerQueue::AddTimerInLoop, this, timer));
+    return TimerId(timer, timer->sequence());
+}
+
+void TimerQueue::Cancel(TimerId timer_id) {
+    loop_->RunInLoop(std::bind(&TimerQueue::CancelInLoop, this, timer_id));
+}
+
+void TimerQueue::AddTimerInLoop(Timer *timer) {
+    bool earliest_changed = Insert(timer);
+    if (earliest_changed) {
+        ResetTimerFd(timer_fd_, timer->expiration());
+    }
+}
+
+void TimerQueue::CancelInLoop(TimerId timer_id) {
+    ActiveTimer timer(timer_id.timer_, timer_id.sequence_);
+    auto it = active_timers_.find(timer);
+    if (it != active_timers_.end()) {
+        timers_.erase(Entry(it->first->expiration(), it->first));
+        delete it->first;
+        active_timers_.erase(it);
+    } else if (calling_expired_timers_) {
+        canceling_timers_.insert(timer);
+    }
+}
+
+void TimerQueue::HandleRead() {
+    int64_t now = NowMicroseconds();
+    ReadTimerFd(timer_fd_);
+
+    std::vector<Entry> expired = GetExpired(now);
+
+    calling_expired_timers_ = true;
+    canceling_timers_.clear();
+    for (const Entry &entry : expired) {
+        entry.second->Run();
+    }
+    calling_expired_timers_ = false;
+
+    Reset(expired, now);
+}
+
+std::vector<TimerQueue::Entry> TimerQueue::GetExpired(int64_t now) {
+    // 第二个元素取最大指针值, upper bound 之前的都已到期
+    Entry sentry(now, reinterpret_cast<Timer*>(UINTPTR_MAX));
+    auto end = timers_.upper_bound(sentry);
+
+    std::vector<Entry> expired(timers_.begin(), end);
+    timers_.erase(timers_.begin(), end);
+    for (const Entry &entry : expired) {
+        active_timers_.erase(ActiveTimer(entry.second, entry.second->sequence()));
+    }
+    return expired;
+}
+
+void TimerQueue::Reset(const std::vector<Entry> &expired, int64_t now) {
+    for (const Entry &entry : expired) {
+        ActiveTimer timer(entry.second, entry.second->sequence());
+        if (entry.second->repeat() && canceling_timers_.find(timer) == canceling_timers_.end()) {
+            entry.second->Restart(now);
+            Insert(entry.second);
+        } else {
+            delete entry.second;
+        }
+    }
+
+    if (!timers_.empty()) {
+        ResetTimerFd(timer_fd_, timers_.begin()->second->expiration());
+    }
+}
+
+bool TimerQueue::Insert(Timer *timer) {
+    bool earliest_changed = false;
+    int64_t when = timer->expiration();
+    auto it = timers_.begin();
+    if (it == timers_.end() || when < it->first) {
+        earliest_changed = true;
+    }
+    timers_.insert(Entry(when, timer));
+    active_timers_.insert(ActiveTimer(timer, timer->sequence()));
+    return earliest_changed;
+}
+
+} // namespace event
@@ -0,0 +1,163 @@
+#include "event/timing_wheel.h"
+#include "event/event_loop.h"
+
+namespace event {
+
+TimingWheel::Entry::Entry(const Callback &cb)
+        : expire_tick_(0),
+          wheel_(nullptr),
+          callback_(cb) {
+    prev = nullptr;
+    next = nullptr;
+}
+
+TimingWheel::Entry::~Entry() {
+    if (wheel_) wheel_->Cancel(this);
+}
+
+TimingWheel::TimingWheel(EventLoop *loop, double tick)
+        : loop_(loop),
+          tick_us_(static_cast<int64_t>(tick * 1000000)),
+          current_tick_(NowMicroseconds() / tick_us_),
+          size_(0),
+          started_(false) {
+    for (int level = 0; level < kLevels; ++level) {
+        for (int slot = 0; slot < kSlots; ++slot) {
+            InitList(&slots_[level][slot]);
+        }
+    }
+}
+
+TimingWheel::~TimingWheel() {
+    if (started_) loop_->Cancel(tick_timer_);
+    for (int level = 0; level < kLevels; ++level) {
+        for (int slot = 0; slot < kSlots; ++slot) {
+            Node *head = &slots_[level][slot];
+            while (head->next != head) {
+                Entry *entry = static_cast<Entry*>(head->next);
+                Unlink(entry);
+                entry->wheel_ = nullptr;
+            }
+        }
+    }
+}
+
+void TimingWheel::Schedule(Entry *entry, double timeout) {
+    if (!started_) {
+        started_ = true;
+        current_tick_ = NowMicroseconds() / tick_us_;
+        tick_timer_ = loop_->RunEvery(static_cast<double>(tick_us_) / 1000000,
+                                      std::bind(&TimingWheel::OnTick, this));
+    }
+
+    if (entry->wheel_) {
+        Unlink(entry);
+    } else {
+        entry->wheel_ = this;
+        ++size_;
+    }
+    // 向上取整, 保证不会早于 timeout 触发
+    int64_t ticks = (static_cast<int64_t>(timeout * 1000000) + tick_us_ - 1) / tick_us_;
+    entry->expire_tick_ = NowMicroseconds() / tick_us_ + ticks;
+    Insert(entry);
+}
+
+void TimingWheel::Cancel(Entry *entry) {
+    if (entry->wheel_ == this) {
+        Unlink(entry);
+        entry->wheel_ = nullptr;
+        --size_;
+    }
+}
+
+void TimingWheel::OnTick() {
+    int64_t now_tick = NowMicroseconds() / tick_us_;
+    while (current_tick_ <= now_tick) {
+        Advance();
+    }
+}
+
+void TimingWheel::Advance() {
+    int index = static_cast<int>(current_tick_ & kSlotMask);
+    if (index == 0) {
+        Cascade(1);
+    }
+
+    // 先把整个槽摘到本地链表, 回调中对其他项的增删不影响遍历
+    Node expired;
+    InitList(&expired);
+    Node *head = &slots_[0][index];
+    if (head->next != head) {
+        expired.next = head->next;
+        expired.prev = head->prev;
+        expired.next->prev = &expired;
+        expired.prev->next = &expired;
+        InitList(head);
+    }
+    ++current_tick_;
+
+    while (expired.next != &expired) {
+        Entry *entry = static_cast<Entry*>(expired.next);
+        Unlink(entry);
+        entry->wheel_ = nullptr;
+        --size_;
+        entry->callback_();
+    }
+}
+
+void TimingWheel::Cascade(int level) {
+    if (level >= kLevels) return;
+    int index = static_cast<int>((current_tick_ >> (level * kLevelBits)) & kSlotMask);
+    if (index == 0) {
+        Cascade(level + 1);
+    }
+
+    Node *head = &slots_[level][index];
+    while (head->next != head) {
+        Entry *entry = static_cast<Entry*>(head->next);
+        Unlink(entry);
+        Insert(entry);
+    }
+}
+
+void TimingWheel::Insert(Entry *entry) {
+    if (entry->expire_tick_ < current_tick_) {
+        entry->expire_tick_ = current_tick_;
+    }
+    int64_t delta = entry->expire_tick_ - current_tick_;
+    int level = 0;
+    while (level < kLevels - 1 && delta >= (static_cast<int64_t>(1) << ((level + 1) * kLevelBits))) {
+        ++level;
+    }
+    if (level == kLevels - 1) {
+        // 超出时间轮范围的项放在最高层最远的槽, 级联时重新计算
+        int64_t max_delta = (static_cast<int64_t>(1) << (kLevels * kLevelBits)) - 1;
+        if (delta > max_delta) {
+            delta = max_delta;
+        }
+    }
+    int64_t expire = current_tick_ + delta;
+    int index = static_cast<int>((expire >> (level * kLevelBits)) & kSlotMask);
+    Append(&slots_[level][index], entry);
+}
+
+void TimingWheel::InitList(Node *head) {
+    head->prev = head;
+    head->next = head;
+}
+
+void TimingWheel::Append(Node *head, Node *node) {
+    node->prev = head->prev;
+    node->next = head;
+    head->prev->next = node;
+    head->prev = node;
+}
+
+void TimingWheel::Unlink(Node *node) {
+    node->prev->next = node->next;
+    node->next->prev = node->prev;
+    node->prev = nullptr;
+    node->next = nullptr;
+}
+
+} // namespace event
@@ -0,0 +1,326 @@
+#include "event/uring_poller.h"
+#include "event/channel.h"
+#include "log/logger.h"
+
+#include <linux/io_uring.h>
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+
+namespace event {
+
+namespace {
+
+int IoUringSetup(unsigned entries, io_uring_params *params) {
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+int IoUringEnter(int fd, unsigned to_submit, unsigned min_complete,
+                 unsigned flags, const void *arg, size_t arg_size) {
+    return static_cast<int>(syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, arg, arg_size));
+}
+
+inline unsigned LoadAcquire(const unsigned *p) {
+    return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+}
+
+inline void StoreRelease(unsigned *p, unsigned v) {
+    __atomic_store_n(p, v, __ATOMIC_RELEASE);
+}
+
+inline uint64_t MakeUserData(int fd, uint32_t generation) {
+    return (static_cast<uint64_t>(fd) << 32) | generation;
+}
+
+// 删除请求自身的完成事件不需要处理
+const uint64_t kRemoveUserData = ~0ULL;
+
+// poll 的事件位和 epoll 相同, 只需要去掉 EPOLLET
+const uint32_t kPollMask = ~static_cast<uint32_t>(EPOLLET);
+
+} // namespace
+
+UringPoller* UringPoller::Create() {
+    UringPoller *poller = new UringPoller();
+    if (!poller->Init()) {
+        delete poller;
+        return nullptr;
+    }
+    return poller;
+}
+
+UringPoller::UringPoller()
+        : ring_fd_(-1),
+          sq_ring_ptr_(MAP_FAILED),
+          sq_ring_size_(0),
+          sq_head_(nullptr),
+          sq_tail_(nullptr),
+          sq_mask_(nullptr),
+          sq_array_(nullptr),
+          sqes_(static_cast<io_uring_sqe*>(MAP_FAILED)),
+          sqes_size_(0),
+          sqe_tail_(0),
+          sqe_submitted_(0),
+          cq_ring_ptr_(MAP_FAILED),
+          cq_ring_size_(0),
+          cq_head_(nullptr),
+          cq_tail_(nullptr),
+          cq_mask_(nullptr),
+          cqes_(nullptr),
+          round_(0) {}
+
+UringPoller::~UringPoller() {
+    if (sqes_ != MAP_FAILED) munmap(sqes_, sqes_size_);
+    if (cq_ring_ptr_ != MAP_FAILED && cq_ring_ptr_ != sq_ring_ptr_) munmap(cq_ring_ptr_, cq_ring_size_);
+    if (sq_ring_ptr_ != MAP_FAILED) munmap(sq_ring_ptr_, sq_ring_size_);
+    if (ring_fd_ >= 0) ::close(ring_fd_);
+}
+
+bool UringPoller::Init() {
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    params.flags = IORING_SETUP_CLAMP | IORING_SETUP_COOP_TASKRUN;
+    ring_fd_ = IoUringSetup(kEntries, &params);
+    if (ring_fd_ < 0 && errno == EINVAL) {
+        // 老内核不认识 COOP_TASKRUN
+        memset(&params, 0, sizeof(params));
+        params.flags = IORING_SETUP_CLAMP;
+        ring_fd_ = IoUringSetup(kEntries, &params);
+    }
+    if (ring_fd_ < 0) {
+        LOG_WARN << "io_uring_setup error: " << strerror(errno);
+        return false;
+    }
+
+    // 需要 EXT_ARG 带超时等待 (5.11), RSRC_TAGS 标志着支持 multishot poll (5.13)
+    const unsigned required = IORING_FEAT_SINGLE_MMAP | IORING_FEAT_NODROP
+                              | IORING_FEAT_EXT_ARG | IORING_FEAT_RSRC_TAGS;
+    if ((params.features & required) != required) {
+        LOG_WARN << "io_uring lacks required features: " << params.features;
+        return false;
+    }
+
+    sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    if (cq_ring_size_ > sq_ring_size_) sq_ring_size_ = cq_ring_size_;
+    cq_ring_size_ = sq_ring_size_;
+
+    sq_ring_ptr_ = mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQ_RING);
+    if (sq_ring_ptr_ == MAP_FAILED) {
+        LOG_WARN << "io_uring mmap sq ring error: " << strerror(errno);
+        return false;
+    }
+    cq_ring_ptr_ = sq_ring_ptr_;
+
+    sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+    sqes_ = static_cast<io_uring_sqe*>(mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE,
+                                            MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQES));
+    if (sqes_ == MAP_FAILED) {
+        LOG_WARN << "io_uring mmap sqes error: " << strerror(errno);
+        return false;
+    }
+
+    char *sq = static_cast<char*>(sq_ring_ptr_);
+    sq_head_ = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    sq_tail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    sq_mask_ = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    sq_array_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+
+    char *cq = static_cast<char*>(cq_ring_ptr_);
+    cq_head_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    cq_tail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    cq_mask_ = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+    sqe_tail_ = *sq_tail_;
+    sqe_submitted_ = sqe_tail_;
+    return true;
+}
+
+void UringPoller::Poll(ChannelList &active_channels, int timeout_ms) {
+    // 水平触发的 Channel 在回调执行完之后重新注册
+    for (int fd : rearm_list_) {
+        Entry &entry = entries_[fd];
+        entry.rearm_queued = false;
+        if (entry.channel && !entry.armed) Arm(fd, entry);
+    }
+    rearm_list_.clear();
+
+    const unsigned to_submit = sqe_tail_ - sqe_submitted_;
+    const bool has_completions = LoadAcquire(cq_tail_) != *cq_head_;
+    const int timeout = has_completions ? 0 : timeout_ms;
+    if (Enter(to_submit, timeout == 0 ? 0 : 1, IORING_ENTER_GETEVENTS, timeout) < 0) {
+        return;
+    }
+
+    ++round_;
+    size_t first = active_channels.size();
+    unsigned head = *cq_head_;
+    const unsigned tail = LoadAcquire(cq_tail_);
+    const unsigned mask = *cq_mask_;
+    for (; head != tail; ++head) {
+        HandleCompletion(cqes_[head & mask], active_channels);
+    }
+    StoreRelease(cq_head_, head);
+
+    for (size_t i = first; i < active_channels.size(); ++i) {
+        Channel *channel = active_channels[i];
+        channel->set_revents(entries_[channel->fd()].revents);
+    }
+}
+
+void UringPoller::HandleCompletion(const io_uring_cqe &cqe, ChannelList &active_channels) {
+    if (cqe.user_data == kRemoveUserData) return;
+
+    const int fd = static_cast<int>(cqe.user_data >> 32);
+    const uint32_t generation = static_cast<uint32_t>(cqe.user_data);
+    const bool more = cqe.flags & IORING_CQE_F_MORE;
+
+    if (fd < 0 || static_cast<size_t>(fd) >= entries_.size()
+            || entries_[fd].generation != generation || !entries_[fd].channel) {
+        // 已经被替换或删除的请求, 如果仍然有效则取消, 防止 fd 复用后残留
+        if (more) PrepareRemove(cqe.user_data);
+        return;
+    }
+
+    Entry &entry = entries_[fd];
+    if (!more) {
+        // 一次性 poll 已完成, 或者 multishot 被内核终止, 都需要重新注册
+        entry.armed = false;
+        QueueRearm(fd, entry);
+    }
+
+    if (cqe.res < 0) {
+        if (cqe.res != -ECANCELED) {
+            LOG_ERROR << "io_uring poll error on fd " << fd << ": " << strerror(-cqe.res);
+        }
+        return;
+    }
+
+    if (entry.round != round_) {
+        entry.round = round_;
+        entry.revents = 0;
+        active_channels.push_back(entry.channel);
+    }
+    entry.revents |= static_cast<uint32_t>(cqe.res);
+}
+
+bool UringPoller::HasChannel(Channel *channel) const {
+    int fd = channel->fd();
+    return fd >= 0 && static_cast<size_t>(fd) < entries_.size() && entries_[fd].channel == channel;
+}
+
+void UringPoller::UpdateChannel(Channel *channel) {
+    const int fd = channel->fd();
+    Entry &entry = GetEntry(fd);
+
+    if (channel->IsNoneEvent()) {
+        if (entry.channel) {
+            Disarm(fd, entry);
+            entry.channel = nullptr;
+        }
+        return;
+    }
+
+    entry.channel = channel;
+    if (entry.armed) {
+        if (entry.mask == static_cast<uint32_t>(channel->events())) return;
+        Disarm(fd, entry);
+    }
+    Arm(fd, entry);
+}
+
+void UringPoller::RemoveChannel(Channel *channel) {
+    const int fd = channel->fd();
+    if (!HasChannel(channel)) return;
+    Entry &entry = entries_[fd];
+    Disarm(fd, entry);
+    entry.channel = nullptr;
+}
+
+UringPoller::Entry& UringPoller::GetEntry(int fd) {
+    if (static_cast<size_t>(fd) >= entries_.size()) {
+        Entry empty = { nullptr, 0, 0, 0, 0, false, false };
+        GrowForFd(entries_, fd, empty);
+    }
+    return entries_[fd];
+}
+
+void UringPoller::Arm(int fd, Entry &entry) {
+    const uint32_t events = static_cast<uint32_t>(entry.channel->events());
+    io_uring_sqe *sqe = GetSqe();
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = fd;
+    sqe->poll32_events = events & kPollMask;
+    sqe->len = (events & EPOLLET) ? IORING_POLL_ADD_MULTI : 0;
+    sqe->user_data = MakeUserData(fd, entry.generation);
+    entry.mask = events;
+    entry.armed = true;
+}
+
+void UringPoller::Disarm(int fd, Entry &entry) {
+    if (entry.armed) {
+        PrepareRemove(MakeUserData(fd, entry.generation));
+        entry.armed = false;
+    }
+    // 之后到达的旧完成事件都会因为 generation 不匹配被丢弃
+    ++entry.generation;
+    entry.round = 0;
+}
+
+void UringPoller::QueueRearm(int fd, Entry &entry) {
+    if (!entry.rearm_queued) {
+        entry.rearm_queued = true;
+        rearm_list_.push_back(fd);
+    }
+}
+
+void UringPoller::PrepareRemove(uint64_t user_data) {
+    io_uring_sqe *sqe = GetSqe();
+    sqe->opcode = IORING_OP_POLL_REMOVE;
+    sqe->fd = -1;
+    sqe->addr = user_data;
+    sqe->user_data = kRemoveUserData;
+}
+
+io_uring_sqe* UringPoller::GetSqe() {
+    const unsigned mask = *sq_mask_;
+    if (sqe_tail_ - LoadAcquire(sq_head_) > mask) {
+        // 提交队列满了, 先提交已有的请求
+        Enter(sqe_tail_ - sqe_submitted_, 0, 0, 0);
+    }
+    const unsigned index = sqe_tail_ & mask;
+    io_uring_sqe *sqe = &sqes_[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sq_array_[index] = index;
+    ++sqe_tail_;
+    StoreRelease(sq_tail_, sqe_tail_);
+    return sqe;
+}
+
+int UringPoller::Enter(unsigned to_submit, unsigned min_complete, unsigned flags, int timeout_ms) {
+    io_uring_getevents_arg arg;
+    memset(&arg, 0, sizeof(arg));
+    timespec ts;
+    ts.tv_sec = timeout_ms / 1000;
+    ts.tv_nsec = (timeout_ms % 1000) * 1000000L;
+    if (timeout_ms > 0) arg.ts = reinterpret_cast<uint64_t>(&ts);
+
+    int ret = IoUringEnter(ring_fd_, to_submit, min_complete, flags | IORING_ENTER_EXT_ARG, &arg, sizeof(arg));
+    if (ret < 0) {
+        // 超时和信号中断是正常情况
+        if (errno != ETIME && errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+            LOG_ERROR << "io_uring_enter error: " << strerror(errno);
+        }
+        return ret;
+    }
+    sqe_submitted_ += ret;
+    return ret;
+}
+
+} // namespace event
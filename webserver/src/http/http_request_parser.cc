@@ -28,7 +28,14 @@ bool HttpRequestParser::ParseRequest(net::Buffer *input) {
             if (crlf) {
                 const char *colon = std::find(input->Peek(), crlf, ':');
                 if (colon != crlf) {
-                    headers_[std::string(input->Peek(), colon)] = std::string(colon + 2, crlf);
+                    memory::ArenaString field(input->Peek(), colon, arena_);
+                    memory::ArenaString value(colon + 2, crlf, arena_);
+                    auto it = headers_.find(field);
+                    if (it != headers_.end()) {
+                        it->second.swap(value);
+                    } else {
+                        headers_.emplace(std::move(field), std::move(value));
+                    }
                 } else {
                     state_ = kGotAll;
                     has_more = false;
@@ -50,11 +57,11 @@ bool HttpRequestParser::ParseRequestLine(const char *begin, const char *end) {
     const char *space = std::find(begin, end, ' ');
 
     if (space != end) {
-        method_ = std::string(start, space);
+        method_.assign(start, space);
         start = space + 1;
         space = std::find(start, end, ' ');
         if (space != end) {
-            path_ = std::string(start, space);
+            path_.assign(start, space);
             start = space + 1;
             ok = end - start == 8 && std::equal(start, end - 1, "HTTP/1.");
             if (ok) {
@@ -71,6 +78,12 @@ bool HttpRequestParser::ParseRequestLine(const char *begin, const char *end) {
     return ok;
 }
 
+const memory::ArenaString& HttpRequestParser::GetHeader(const char *field) const {
+    static const memory::ArenaString kEmpty;
+    auto it = headers_.find(memory::ArenaString(field, arena_));
+    return it == headers_.end() ? kEmpty : it->second;
+}
+
 void HttpRequestParser::reset() {
     state_ = kExpectRequestLine;
     method_.clear();
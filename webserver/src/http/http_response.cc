@@ -2,14 +2,28 @@
 #include "net/buffer.h"
 
 #include <cstring>
+#include <strings.h>
 
 namespace http {
 
+void HttpResponse::AddHeader(const char *key, size_t key_len, const char *value, size_t value_len) {
+    if (key_len == 14 && strncasecmp(key, "Content-Length", 14) == 0) {
+        has_content_length_ = true;
+    }
+    memory::ArenaString field(key, key_len, arena_);
+    auto it = headers_.find(field);
+    if (it != headers_.end()) {
+        it->second.assign(value, value_len);
+    } else {
+        headers_.emplace(std::move(field), memory::ArenaString(value, value_len, arena_));
+    }
+}
+
 void HttpResponse::AppendToBuffer(net::Buffer *output) const {
-    char buf[32];
+    char buf[64];
     snprintf(buf, sizeof(buf), "HTTP/1.1 %d ", status_code_);
     output->Append(buf, strlen(buf));
-    output->Append(status_message_);
+    output->Append(status_message_.data(), status_message_.size());
     output->Append("\r\n");
 
     if (close_connection_) {
@@ -19,17 +33,25 @@ void HttpResponse::AppendToBuffer(net::Buffer *output) const {
     }
 
     for (const auto &header : headers_) {
-        output->Append(header.first);
-        output->Append(": ");
-        output->Append(header.second);
-        output->Append("\r\n");
+        output->Append(header.first.data(), header.first.size());
+        output->Append(": ", 2);
+        output->Append(header.second.data(), header.second.size());
+        output->Append("\r\n", 2);
     }
 
-    if (!body_.empty()) {
-        output->Append("Content-Length: ");
-        output->Append(std::to_string(body_.size()));
-        output->Append("\r\n\r\n");
-        output->Append(body_);
+    if (body_blob_) {
+        if (!has_content_length_) {
+            int len = snprintf(buf, sizeof(buf), "Content-Length: %zu\r\n", body_blob_->size());
+            output->Append(buf, len);
+        }
+        output->Append("\r\n", 2);
+    } else if (has_content_length_) {
+        output->Append("\r\n", 2);
+        output->Append(body_.data(), body_.size());
+    } else if (!body_.empty()) {
+        int len = snprintf(buf, sizeof(buf), "Content-Length: %zu\r\n\r\n", body_.size());
+        output->Append(buf, len);
+        output->Append(body_.data(), body_.size());
     } else {
         output->Append("Content-Length: 0\r\n\r\n");
     }
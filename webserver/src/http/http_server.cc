@@ -2,10 +2,18 @@
 #include "cache/lfu_cache.h"
 #include "log/logger.h"
 
+#include <cstring>
 #include <sys/stat.h>
 
 namespace http {
 
+namespace {
+
+// 每个 I/O 线程一份请求级内存, 响应写入连接后整体复位
+thread_local memory::Arena t_request_arena;
+thread_local net::Buffer t_response_buffer;
+
+} // namespace
 
 void DefaultHttpCallback(const HttpRequestParser &req,
                          HttpResponse &resp,
@@ -23,16 +31,19 @@ void CacheTestHttpCallback(const HttpRequestParser &req,
     resp.SetCloseConnection(false);
     resp.AddHeader("Server", "LFU Cache Server");
 
-    std::string file_name = req.path();
+    // 临时字符串都从请求 arena 上分配
+    memory::Arena *arena = resp.arena();
+    memory::ArenaString file_name(req.path(), arena);
     if (file_name == "/" || file_name.empty()) {
-        file_name = "/index.html";
+        file_name.assign("/index.html");
     }
     size_t question_mark = file_name.find('?');
-    if (question_mark != std::string::npos) {
-        file_name = file_name.substr(0, question_mark);
+    if (question_mark != memory::ArenaString::npos) {
+        file_name.resize(question_mark);
     }
 
-    std::string file_path = web_root + file_name;
+    memory::ArenaString file_path(web_root.data(), web_root.size(), arena);
+    file_path.append(file_name);
     struct stat file_stat;
     if (stat(file_path.c_str(), &file_stat) < 0) {
         // 文件不存在
@@ -50,23 +61,24 @@ void CacheTestHttpCallback(const HttpRequestParser &req,
         return;
     }
 
-    int pos = file_name.find_last_of('.');
-    std::string file_type;
-    if (pos != std::string::npos) {
-        file_type = file_name.substr(pos);
+    size_t pos = file_name.find_last_of('.');
+    if (pos != memory::ArenaString::npos) {
+        resp.AddHeader("Content-Type", 12, file_name.data() + pos, file_name.size() - pos);
     } else {
-        file_type = "text/plain";
+        resp.AddHeader("Content-Type", "text/plain");
     }
 
-    resp.AddHeader("Content-Type", file_type);
-    resp.AddHeader("Content-Length", std::to_string(file_stat.st_size));
+    char length[32];
+    snprintf(length, sizeof(length), "%lld", static_cast<long long>(file_stat.st_size));
+    resp.AddHeader("Content-Length", length);
 
     if (req.method() == "HEAD") {
         return;
     }
 
-    std::string file_content;
-    if (!cache::LfuCache::instance().Get(file_name, file_content)) {
+    std::string key(file_name.data(), file_name.size());
+    net::BlobPtr file_content;
+    if (!cache::LfuCache::instance().Get(key, file_content)) {
         FILE *fp = fopen(file_path.c_str(), "rb");
         if (fp == nullptr) {
             resp.SetStatusCode(HttpResponse::k404NotFound);
@@ -75,21 +87,34 @@ void CacheTestHttpCallback(const HttpRequestParser &req,
             return;
         }
 
+        std::string content;
+        content.reserve(file_stat.st_size);
         char buffer[4096];
         size_t nread;
         while ((nread = fread(buffer, 1, sizeof(buffer), fp)) > 0) {
-            file_content.append(buffer, nread);
+            content.append(buffer, nread);
         }
-        cache::LfuCache::instance().Set(file_name, file_content);
         fclose(fp);
+        file_content = std::make_shared<const net::Blob>(std::move(content));
+        cache::LfuCache::instance().Set(key, file_content);
     }
 
+    // 缓存中的内容直接作为 body 发送, 不再拷贝进响应
     resp.SetBody(file_content);
 }
 
-HttpServer::HttpServer(event::EventLoop *loop, const net::InetAddress &addr)
-        : server_(loop, addr, "HttpServer"),
+HttpServer::HttpServer(event::EventLoop *loop, const net::InetAddress &addr, net::TcpServer::Option option)
+        : max_keep_alive_requests_(kDefaultMaxKeepAliveRequests),
+          server_(loop, addr, "HttpServer", option),
           http_callback_(CacheTestHttpCallback) {
+    server_.SetIdleTimeout(kDefaultIdleTimeout);
+    server_.SetHeaderReadTimeout(kDefaultHeaderReadTimeout);
+    // 响应头和 body 分两次写, 不关闭 Nagle 时 body 要等对端确认头部 (延迟确认下约 40ms);
+    // 头部用 MSG_MORE 和 body 合并发送, 不会多出一个小报文
+    net::SocketOptions options;
+    options.tcp_nodelay = true;
+    options.cork_responses = true;
+    server_.SetSocketOptions(options);
     server_.SetConnectionCallback(
         std::bind(&HttpServer::onConnection, this, std::placeholders::_1)
     );
@@ -105,33 +130,55 @@ HttpServer::HttpServer(event::EventLoop *loop, const net::InetAddress &addr)
 }
 
 void HttpServer::Start() {
-    LOG_INFO << "HttpServer[" << server_.name() << "] starts listening on " << server_.ip_port();
+    for (const net::InetAddress &addr : server_.listen_addrs()) {
+        LOG_INFO << "HttpServer[" << server_.name() << "] starts listening on " << addr.GetIpPort();
+    }
     server_.Start();
 }
 
 void HttpServer::onConnection(const net::TcpConnectionPtr &conn) {
-    LOG_INFO << "HttpServer - " << conn->local_addr().GetIpPort() << " -> "
+    LOG_DEBUG << "HttpServer - " << conn->local_addr().GetIpPort() << " -> "
              << conn->peer_addr().GetIpPort() << " is "
              << (conn->Connected() ? "UP" : "DOWN");
+    if (connection_callback_) {
+        connection_callback_(conn);
+    }
 }
 
 void HttpServer::onMessage(const net::TcpConnectionPtr &conn, net::Buffer *buf) {
-    HttpRequestParser parser;
-    if (parser.ParseRequest(buf)) {
-        if (parser.GotAll()) {
-            onRequest(conn, parser);
-            parser.reset();
+    // 流水线请求逐个处理, 直到输入不完整, 连接因输出积压暂停读取, 或用完本轮预算
+    while (buf->ReadableBytes() > 0 && conn->Connected() && !conn->reading_paused()) {
+        // 请求头收齐之前不解析, 不完整的请求留在输入缓冲区里, 由请求头读取超时兜底
+        if (!memmem(buf->Peek(), buf->ReadableBytes(), "\r\n\r\n", 4)) {
+            if (buf->ReadableBytes() > kMaxHeaderSize) {
+                LOG_WARN << "HttpServer - request header too large from " << conn->peer_addr().GetIpPort();
+                conn->ForceClose();
+            }
+            return;
         }
-    } else {
-        conn->Shutdown();
+        if (!conn->ConsumeRequestBudget()) return;
+
+        {
+            HttpRequestParser parser(&t_request_arena);
+            if (parser.ParseRequest(buf)) {
+                if (parser.GotAll()) {
+                    onRequest(conn, parser);
+                    parser.reset();
+                }
+            } else {
+                conn->Shutdown();
+            }
+        }
+        // parser 和 response 已析构, 本次请求的临时内存可以整体回收
+        t_request_arena.Reset();
     }
 }
 
 void HttpServer::onRequest(const net::TcpConnectionPtr &conn, const HttpRequestParser &req) {
-    const std::string &connection = req.GetHeader("Connection");
+    const memory::ArenaString &connection = req.GetHeader("Connection");
     bool close = connection == "close" ||
                  (req.version() == "HTTP/1.0" && connection != "Keep-Alive");
-    HttpResponse response(close);
+    HttpResponse response(close, req.arena());
     if (http_callback_) {
         http_callback_(req, response, web_root_);
     } else {
@@ -139,10 +186,22 @@ void HttpServer::onRequest(const net::TcpConnectionPtr &conn, const HttpRequestP
         response.SetStatusMessage("Not Found");
         response.SetCloseConnection(true);
     }
+    if (max_keep_alive_requests_ > 0 && conn->IncrementRequests() >= max_keep_alive_requests_) {
+        response.SetCloseConnection(true);
+    }
 
-    net::Buffer buf;
+    net::Buffer &buf = t_response_buffer;
     response.AppendToBuffer(&buf);
-    conn->Send(&buf);
+    const net::BlobPtr &body = response.body_blob();
+    if (body && body->size() < net::ChainBuffer::kMinBlobSegment) {
+        // 小 body 和头部合并成一次写
+        buf.Append(body->data(), body->size());
+        conn->Send(&buf);
+    } else {
+        conn->Send(&buf, body);
+    }
+    // 连接已不在 kConnected 状态时 Send 不会取走数据, 这里清空, 免得混进下一个连接的响应
+    buf.RetrieveAll();
     if (response.close_connection()) {
         conn->Shutdown();
     }
@@ -14,10 +14,11 @@ size_t IntToString(char *buffer, T value) {
         value = -value;
     }
 
-    while (value) {
+    // 至少输出一位, 否则 0 会变成空字符串
+    do {
         *buf++ = '0' + value % 10;
         value /= 10;
-    }
+    } while (value);
 
     if (is_negative) *buf++ = '-';
     *buf = '\0';
@@ -0,0 +1,72 @@
+#include "memory/arena.h"
+
+#include <cstdint>
+
+namespace memory {
+
+Arena::Arena(size_t block_size)
+        : block_size_(block_size),
+          head_(nullptr),
+          current_(nullptr),
+          end_(nullptr),
+          bytes_used_(0),
+          capacity_(0) {}
+
+Arena::~Arena() {
+    FreeBlocks(head_);
+}
+
+void* Arena::Allocate(size_t size, size_t align) {
+    uintptr_t p = reinterpret_cast<uintptr_t>(current_);
+    size_t padding = (align - (p % align)) % align;
+    if (current_ && size + padding <= static_cast<size_t>(end_ - current_)) {
+        char* result = current_ + padding;
+        current_ = result + size;
+        bytes_used_ += size + padding;
+        return result;
+    }
+    return AllocateSlow(size, align);
+}
+
+void Arena::Reset() {
+    if (head_ && head_->next) {
+        // 上一轮用了多块内存, 合并成一块, 下一轮一次放得下
+        size_t total = capacity_;
+        FreeBlocks(head_);
+        head_ = nullptr;
+        capacity_ = 0;
+        NewBlock(total);
+    }
+    if (head_) {
+        current_ = reinterpret_cast<char*>(head_ + 1);
+        end_ = reinterpret_cast<char*>(head_ + 1) + head_->size;
+    }
+    bytes_used_ = 0;
+}
+
+void* Arena::AllocateSlow(size_t size, size_t align) {
+    size_t need = size + align;
+    NewBlock(need > block_size_ ? need : block_size_);
+    return Allocate(size, align);
+}
+
+Arena::Block* Arena::NewBlock(size_t size) {
+    Block* block = static_cast<Block*>(operator new(sizeof(Block) + size));
+    block->next = head_;
+    block->size = size;
+    head_ = block;
+    current_ = reinterpret_cast<char*>(block + 1);
+    end_ = current_ + size;
+    capacity_ += size;
+    return block;
+}
+
+void Arena::FreeBlocks(Block* block) {
+    while (block) {
+        Block* next = block->next;
+        operator delete(block);
+        block = next;
+    }
+}
+
+} // namespace memory
@@ -1,111 +1,299 @@
 #include "memory/memory_pool.h"
 
+#include <algorithm>
+#include <new>
+#include <cstdio>
+#include <cstdlib>
+#include <time.h>
+#include <sys/mman.h>
+
+#ifdef MEMORY_POOL_DEBUG
+#include <execinfo.h>
+#include <unistd.h>
+#include <unordered_map>
+#endif
+
 namespace memory {
 
+namespace {
+
+std::atomic<uint64_t> g_huge_allocations(0);
+std::atomic<uint64_t> g_huge_deallocations(0);
+std::atomic<uint64_t> g_huge_live_bytes(0);
+
+#ifdef MEMORY_POOL_DEBUG
+const int kDebugFrames = 8;
+
+struct AllocationSite {
+    size_t size;
+    int depth;
+    void* frames[kDebugFrames];
+};
+
+using AllocationMap = std::unordered_map<void*, AllocationSite>;
+
+std::mutex& DebugMutex() {
+    static std::mutex mutex;
+    return mutex;
+}
+
+AllocationMap& LiveAllocations() {
+    // 故意不释放, 保证退出阶段的其他静态对象析构时仍然可用
+    static AllocationMap *live = new AllocationMap;
+    return *live;
+}
+
+void RecordAllocation(void *p, size_t size) {
+    AllocationSite site;
+    site.size = size;
+    site.depth = backtrace(site.frames, kDebugFrames);
+    std::lock_guard<std::mutex> lock(DebugMutex());
+    LiveAllocations()[p] = site;
+}
+
+// 释放时的 size 与分配时不一致只报告, 并改用分配时的 size, 块仍回到它所属的 size class
+bool RecordDeallocation(void *p, size_t *size) {
+    std::lock_guard<std::mutex> lock(DebugMutex());
+    auto it = LiveAllocations().find(p);
+    if (it == LiveAllocations().end()) {
+        void* frames[kDebugFrames];
+        int depth = backtrace(frames, kDebugFrames);
+        fprintf(stderr, "memory pool: double free or foreign pointer %p (size %zu) at:\n", p, *size);
+        backtrace_symbols_fd(frames, depth, STDERR_FILENO);
+        return false;
+    }
+    if (it->second.size != *size) {
+        fprintf(stderr, "memory pool: %p allocated with size %zu but freed with size %zu\n",
+                p, it->second.size, *size);
+        *size = it->second.size;
+    }
+    LiveAllocations().erase(it);
+    return true;
+}
+
+void ReportLeaksAtExit() {
+    CheckMemoryLeaks();
+}
+#endif
+
+} // namespace
+
 MemoryPool::MemoryPool() {}
 
 MemoryPool::~MemoryPool() {
     Slot* curr = current_block_;
     while (curr) {
         Slot* next = curr->next;
-        operator delete(reinterpret_cast<void*>(curr));
+        if (UsePageRun()) {
+            munmap(reinterpret_cast<void*>(curr), block_size_);
+        } else {
+            operator delete(reinterpret_cast<void*>(curr));
+        }
         curr = next;
     }
 }
 
-void MemoryPool::Init(int slot_size) {
+void MemoryPool::Init(int slot_size, size_t block_size) {
     slot_size_ = slot_size;
+    block_size_ = block_size;
     current_block_ = nullptr;
     current_slot_ = nullptr;
     last_slot_ = nullptr;
     free_slot_ = nullptr;
+
+    allocations_ = 0;
+    deallocations_ = 0;
+    live_slots_ = 0;
+    peak_slots_ = 0;
+    blocks_ = 0;
+    padding_bytes_ = 0;
 }
 
-Slot* MemoryPool::Allocate() {
+Slot* MemoryPool::Allocate(size_t size) {
+    Slot* result = nullptr;
     if (free_slot_) {
         {
             std::lock_guard<std::mutex> lock(mutex_free_slot_);
             if (free_slot_) {
-                Slot* result = free_slot_;
+                result = free_slot_;
                 free_slot_ = free_slot_->next;
-                return result;
             }
         }
     }
-    return NoFreeSolve();
+    if (!result) result = NoFreeSolve();
+
+    allocations_.fetch_add(1, std::memory_order_relaxed);
+    if (size) padding_bytes_.fetch_add(slot_size_ - size, std::memory_order_relaxed);
+    uint64_t live = live_slots_.fetch_add(1, std::memory_order_relaxed) + 1;
+    uint64_t peak = peak_slots_.load(std::memory_order_relaxed);
+    while (live > peak && !peak_slots_.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {}
+    return result;
 }
 
 
-void MemoryPool::Deallocate(Slot* p) {
+void MemoryPool::Deallocate(Slot* p, size_t size) {
     if (p){
-        std::lock_guard<std::mutex> lock(mutex_free_slot_);
-        p->next = free_slot_;
-        free_slot_ = p;
+        {
+            std::lock_guard<std::mutex> lock(mutex_free_slot_);
+            p->next = free_slot_;
+            free_slot_ = p;
+        }
+        deallocations_.fetch_add(1, std::memory_order_relaxed);
+        live_slots_.fetch_sub(1, std::memory_order_relaxed);
+        if (size) padding_bytes_.fetch_sub(slot_size_ - size, std::memory_order_relaxed);
     }
 }
 
+PoolStats MemoryPool::Stats() const {
+    PoolStats stats;
+    stats.slot_size = static_cast<size_t>(slot_size_);
+    stats.block_size = block_size_;
+    stats.allocations = allocations_.load(std::memory_order_relaxed);
+    stats.deallocations = deallocations_.load(std::memory_order_relaxed);
+    stats.live_slots = live_slots_.load(std::memory_order_relaxed);
+    stats.peak_slots = peak_slots_.load(std::memory_order_relaxed);
+    stats.blocks = blocks_.load(std::memory_order_relaxed);
+    stats.padding_bytes = padding_bytes_.load(std::memory_order_relaxed);
+    return stats;
+}
+
 
+// 调用方需持有 mutex_other_
 Slot* MemoryPool::AllocateBlock() {
-    char *new_block = reinterpret_cast<char*>(operator new(kBlockSize));
-    char *body = new_block + sizeof(Slot*);
-    size_t body_padding = PadPointer(body, static_cast<size_t>(slot_size_));
-
-    Slot* use_slot;
-    {
-        std::lock_guard<std::mutex> lock(mutex_other_);
-        reinterpret_cast<Slot*>(new_block)->next = current_block_;
-        current_block_ = reinterpret_cast<Slot*>(new_block);
-        current_slot_ = reinterpret_cast<Slot*>(body + body_padding);
-        last_slot_ = reinterpret_cast<Slot*>(new_block + kBlockSize - slot_size_ + 1);
-
-        use_slot = current_slot_;
-        current_slot_ += (slot_size_ >> 3);
+    char *new_block;
+    if (UsePageRun()) {
+        // 大对象从整段页上切分, 不经过 malloc 的堆, 避免和小对象互相产生碎片
+        void *run = mmap(nullptr, block_size_, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (run == MAP_FAILED) throw std::bad_alloc();
+        new_block = reinterpret_cast<char*>(run);
+    } else {
+        new_block = reinterpret_cast<char*>(operator new(block_size_));
     }
+    char *body = new_block + sizeof(Slot*);
+    size_t align = std::min(static_cast<size_t>(slot_size_), kMaxAlign);
+    size_t body_padding = PadPointer(body, align);
+
+    blocks_.fetch_add(1, std::memory_order_relaxed);
+    reinterpret_cast<Slot*>(new_block)->next = current_block_;
+    current_block_ = reinterpret_cast<Slot*>(new_block);
+    current_slot_ = reinterpret_cast<Slot*>(body + body_padding);
+    last_slot_ = reinterpret_cast<Slot*>(new_block + block_size_ - slot_size_ + 1);
+
+    Slot* use_slot = current_slot_;
+    current_slot_ += (slot_size_ >> 3);
     return use_slot;
 }
 
 Slot* MemoryPool::NoFreeSolve() {
+    std::lock_guard<std::mutex> lock(mutex_other_);
     if (current_slot_ >= last_slot_) {
         return AllocateBlock();
     }
 
-    Slot* use_slot;
-    {
-        std::lock_guard<std::mutex> lock(mutex_other_);
-        use_slot = current_slot_;
-        current_slot_ += (slot_size_ >> 3);
-    }
+    Slot* use_slot = current_slot_;
+    current_slot_ += (slot_size_ >> 3);
     return use_slot;
 }
 
 MemoryPool& GetMemoryPool(int index) {
-    static MemoryPool memory_pool[64];
+    static MemoryPool memory_pool[kNumSizeClasses];
     return memory_pool[index];
 }
 
+int SizeClassIndex(size_t size) {
+    if (size <= kSmallSizeLimit) {
+        return static_cast<int>((size + 7) >> 3) - 1;
+    }
+    // (size - 1) 所在的 2 的幂区间 [2^power, 2^(power+1)) 等分为 4 档
+    int power = 63 - __builtin_clzl(size - 1);
+    size_t sub = ((size - 1) - (static_cast<size_t>(1) << power)) >> (power - 2);
+    return kNumSmallClasses + (power - 9) * kLargeClassesPerPower + static_cast<int>(sub);
+}
+
+size_t SizeClassSlotSize(int index) {
+    if (index < kNumSmallClasses) {
+        return static_cast<size_t>(index + 1) << 3;
+    }
+    int large = index - kNumSmallClasses;
+    size_t base = static_cast<size_t>(kSmallSizeLimit) << (large / kLargeClassesPerPower);
+    return base + (large % kLargeClassesPerPower + 1) * (base / kLargeClassesPerPower);
+}
+
 void InitMemoryPool() {
-    for (int i = 0; i < 64; ++i) {
-        GetMemoryPool(i).Init((i + 1) << 3);
+    for (int i = 0; i < kNumSmallClasses; ++i) {
+        GetMemoryPool(i).Init(static_cast<int>(SizeClassSlotSize(i)));
+    }
+    for (int i = kNumSmallClasses; i < kNumSizeClasses; ++i) {
+        size_t slot_size = SizeClassSlotSize(i);
+        size_t run_size = std::max(kPageRunSize, kSlotsPerRun * slot_size + kMaxAlign);
+        GetMemoryPool(i).Init(static_cast<int>(slot_size), run_size);
+    }
+#ifdef MEMORY_POOL_DEBUG
+    static std::once_flag flag;
+    std::call_once(flag, [] { std::atexit(ReportLeaksAtExit); });
+#endif
+}
+
+MemoryStats SnapshotMemoryStats() {
+    MemoryStats stats;
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    stats.timestamp_us = static_cast<int64_t>(now.tv_sec) * 1000000 + now.tv_nsec / 1000;
+    stats.classes.reserve(kNumSizeClasses);
+    for (int i = 0; i < kNumSizeClasses; ++i) {
+        stats.classes.push_back(GetMemoryPool(i).Stats());
+    }
+    stats.huge_allocations = g_huge_allocations.load(std::memory_order_relaxed);
+    stats.huge_deallocations = g_huge_deallocations.load(std::memory_order_relaxed);
+    stats.huge_live_bytes = g_huge_live_bytes.load(std::memory_order_relaxed);
+    return stats;
+}
+
+size_t CheckMemoryLeaks() {
+#ifdef MEMORY_POOL_DEBUG
+    std::lock_guard<std::mutex> lock(DebugMutex());
+    for (const auto &item : LiveAllocations()) {
+        fprintf(stderr, "memory pool: leaked %zu bytes at %p, allocated at:\n",
+                item.second.size, item.first);
+        backtrace_symbols_fd(item.second.frames, item.second.depth, STDERR_FILENO);
     }
+    return LiveAllocations().size();
+#else
+    return 0;
+#endif
 }
 
 void* UseMemory(size_t size) {
     if (!size) return nullptr;
-    if (size > 512) return operator new(size);
-
-    int index = ((size + 7) >> 3) - 1;
-    return reinterpret_cast<void*>(GetMemoryPool(index).Allocate());
+    void *p;
+    if (size > kLargeSizeLimit) {
+        p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p == MAP_FAILED) throw std::bad_alloc();
+        g_huge_allocations.fetch_add(1, std::memory_order_relaxed);
+        g_huge_live_bytes.fetch_add(size, std::memory_order_relaxed);
+    } else {
+        p = reinterpret_cast<void*>(GetMemoryPool(SizeClassIndex(size)).Allocate(size));
+    }
+#ifdef MEMORY_POOL_DEBUG
+    RecordAllocation(p, size);
+#endif
+    return p;
 }
 
 void FreeMemory(size_t size, void *p) {
     if (!p) return;
-    if (size > 512) {
-        operator delete(p);
+#ifdef MEMORY_POOL_DEBUG
+    if (!RecordDeallocation(p, &size)) return;
+#endif
+    if (size > kLargeSizeLimit) {
+        munmap(p, size);
+        g_huge_deallocations.fetch_add(1, std::memory_order_relaxed);
+        g_huge_live_bytes.fetch_sub(size, std::memory_order_relaxed);
         return;
     }
 
-    int index = ((size + 7) >> 3) - 1;
-    GetMemoryPool(index).Deallocate(reinterpret_cast<Slot*>(p));
+    GetMemoryPool(SizeClassIndex(size)).Deallocate(reinterpret_cast<Slot*>(p), size);
 }
 
 } // namespace memory
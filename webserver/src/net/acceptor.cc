@@ -0,0 +1,151 @@
+#include "net/acceptor.h"
+#include "net/inet_address.h"
+#include "event/event_loop.h"
+#include "log/logger.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace net {
+
+static int CreateSocket(sa_family_t family) {
+    int protocol = family == AF_UNIX ? 0 : IPPROTO_TCP;
+    int sockfd = ::socket(family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, protocol);
+    if (sockfd < 0) {
+        LOG_FATAL << "CreateSocket";
+    }
+    return sockfd;
+}
+
+Acceptor::Acceptor(event::EventLoop *loop, const InetAddress &addr, bool reuse_port)
+        : loop_(loop),
+          accept_socket_(new Socket(CreateSocket(addr.family()))),
+          accept_channel_(new event::Channel(loop, accept_socket_->fd())),
+          new_connection_callback_(),
+          batch_done_callback_(),
+          options_(),
+          listening_(false),
+          idle_fd_(::open("/dev/null", O_RDONLY | O_CLOEXEC)),
+          retry_timer_(),
+          is_unix_(addr.IsUnix()),
+          unix_path_() {
+    if (is_unix_) {
+        if (!addr.IsAbstract()) {
+            // 上次运行留下的套接字文件会导致 bind 失败 (EADDRINUSE), 只删除套接字类型的文件
+            unix_path_ = addr.GetIp();
+            struct stat st;
+            if (::stat(unix_path_.c_str(), &st) == 0 && S_ISSOCK(st.st_mode)) {
+                ::unlink(unix_path_.c_str());
+            }
+        }
+    } else {
+        accept_socket_->SetReuseAddr(true);
+        accept_socket_->SetReusePort(reuse_port);
+    }
+    accept_socket_->Bind(addr);
+    accept_channel_->SetReadCallback(std::bind(&Acceptor::HandleRead, this));
+}
+
+Acceptor::~Acceptor() {
+    if (retry_timer_.valid()) loop_->Cancel(retry_timer_);
+    if (listening_) {
+        accept_channel_->DisableAll();
+        accept_channel_->Remove();
+    }
+    if (idle_fd_ >= 0) ::close(idle_fd_);
+    if (!unix_path_.empty()) ::unlink(unix_path_.c_str());
+}
+
+void Acceptor::Listen() {
+    listening_ = true;
+    // 收发缓冲区要在 listen 之前设置, 窗口扩大因子在握手时协商, accept 得到的连接继承这些设置
+    if (options_.recv_buffer > 0) accept_socket_->SetRecvBuffer(options_.recv_buffer);
+    if (options_.send_buffer > 0) accept_socket_->SetSendBuffer(options_.send_buffer);
+    // TCP 专有的选项不适用于 Unix 域套接字
+    if (!is_unix_ && options_.defer_accept > 0) accept_socket_->SetDeferAccept(options_.defer_accept);
+    if (!is_unix_ && options_.fastopen_queue > 0) accept_socket_->SetFastOpen(options_.fastopen_queue);
+    accept_socket_->Listen(options_.listen_backlog);
+    loop_->RunInLoop([this]() { accept_channel_->EnableReading(); });
+}
+
+void Acceptor::HandleRead() {
+    int accepted = AcceptBatch();
+    if (accepted > 0 && batch_done_callback_) batch_done_callback_();
+}
+
+int Acceptor::AcceptBatch() {
+    InetAddress peer_addr;
+    int accepted = 0;
+    for (int i = 0; i < kMaxAcceptsPerEvent; ++i) {
+        int connfd = accept_socket_->Accept(&peer_addr);
+        if (connfd >= 0) {
+            if (new_connection_callback_) {
+                new_connection_callback_(connfd, peer_addr);
+            } else {
+                ::close(connfd);
+            }
+            ++accepted;
+            continue;
+        }
+
+        switch (errno) {
+            case EAGAIN:
+            case EINTR:
+                return accepted;
+            // 连接在 accept 之前已被对端重置, 或被防火墙规则拒绝, 继续处理下一个
+            case ECONNABORTED:
+            case EPROTO:
+            case EPERM:
+                continue;
+            case EMFILE:
+            case ENFILE:
+                LOG_ERROR << "Acceptor: too many open files, dropping connection";
+                DropConnection();
+                return accepted;
+            default:
+                // ENOBUFS/ENOMEM 等, 留给下一轮事件重试
+                LOG_ERROR << "Acceptor: accept error: " << errno;
+                return accepted;
+        }
+    }
+    return accepted;
+}
+
+void Acceptor::DropConnection() {
+    if (idle_fd_ < 0) {
+        PauseAccepting();
+        return;
+    }
+    ::close(idle_fd_);
+    idle_fd_ = ::accept(accept_socket_->fd(), nullptr, nullptr);
+    if (idle_fd_ >= 0) ::close(idle_fd_);
+    idle_fd_ = ::open("/dev/null", O_RDONLY | O_CLOEXEC);
+    // 关闭连接和重新打开之间 fd 被其他线程占用
+    if (idle_fd_ < 0) PauseAccepting();
+}
+
+void Acceptor::PauseAccepting() {
+    if (retry_timer_.valid()) return;
+    // 重试失败时不再重复记录
+    if (accept_channel_->IsReading()) {
+        LOG_ERROR << "Acceptor: no spare fd, pause accepting until /dev/null can be reopened";
+        accept_channel_->DisableReading();
+    }
+    retry_timer_ = loop_->RunAfter(kIdleFdRetryMs / 1000.0, std::bind(&Acceptor::RetryIdleFd, this));
+}
+
+void Acceptor::RetryIdleFd() {
+    retry_timer_ = event::TimerId();
+    if (idle_fd_ < 0) idle_fd_ = ::open("/dev/null", O_RDONLY | O_CLOEXEC);
+    if (idle_fd_ < 0) {
+        PauseAccepting();
+        return;
+    }
+    LOG_INFO << "Acceptor: spare fd restored, resume accepting";
+    if (listening_) accept_channel_->EnableReading();
+}
+
+} // namespace net
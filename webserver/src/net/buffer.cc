@@ -1,4 +1,5 @@
 #include "net/buffer.h"
+#include "net/chunk_pool.h"
 
 #include <errno.h>
 #include <sys/uio.h>
@@ -9,26 +10,44 @@ namespace net {
 const char Buffer::kCRLF[] = "\r\n";
 
 ssize_t Buffer::ReadFd(int fd, int *saved_errno) {
-    char buffer[65536];
-    struct iovec vec[2];
+    // 可写空间不够时借用 ChunkPool 的内存块接收溢出数据, 用完立即归还
+    ChunkPool &pool = ChunkPool::ThreadLocal();
+    struct iovec vec[kMaxSpillChunks + 1];
+    char *spill[kMaxSpillChunks];
     const size_t writable = WritableBytes();
 
     vec[0].iov_base = begin() + write_index_;
     vec[0].iov_len = writable;
-    vec[1].iov_base = buffer;
-    vec[1].iov_len = sizeof(buffer);
 
-    const int iovcnt = (writable < sizeof(buffer)) ? 2 : 1;
-    const ssize_t n = readv(fd, vec, iovcnt);
+    int num_spill = 0;
+    size_t spill_size = 0;
+    while (num_spill < kMaxSpillChunks && writable + spill_size < kMaxSpillChunks * ChunkPool::kChunkSize) {
+        spill[num_spill] = pool.Allocate();
+        vec[num_spill + 1].iov_base = spill[num_spill];
+        vec[num_spill + 1].iov_len = ChunkPool::kChunkSize;
+        spill_size += ChunkPool::kChunkSize;
+        ++num_spill;
+    }
+
+    const ssize_t n = readv(fd, vec, num_spill + 1);
     if (n < 0) {
         *saved_errno = errno;
     } else if (static_cast<size_t>(n) <= writable) {
         write_index_ += n;
     } else {
         write_index_ = buffer_.size();
-        Append(buffer, n);
+        size_t remaining = n - writable;
+        EnsureWritableBytes(remaining);
+        for (int i = 0; remaining > 0; ++i) {
+            size_t len = std::min(remaining, ChunkPool::kChunkSize);
+            Append(spill[i], len);
+            remaining -= len;
+        }
     }
 
+    for (int i = 0; i < num_spill; ++i) {
+        pool.Deallocate(spill[i]);
+    }
     return n;
 }
 
@@ -44,7 +63,8 @@ ssize_t Buffer::WriteFd(int fd, int *saved_errno) {
 
 void Buffer::MakeSpace(size_t len) {
     if (WritableBytes() + PrependableBytes() < len + kPrependSize) {
-        buffer_.resize(write_index_ + len);
+        // 按倍数扩容, 避免大量追加时反复 realloc
+        buffer_.resize(std::max(buffer_.size() * 2, write_index_ + len));
     } else {
         size_t readable = ReadableBytes();
         std::copy(begin() + read_index_, begin() + write_index_, begin() + kPrependSize);
@@ -0,0 +1,157 @@
+#include "net/chain_buffer.h"
+#include "net/chunk_pool.h"
+
+#include <algorithm>
+#include <cstring>
+#include <errno.h>
+#include <sys/uio.h>
+
+namespace net {
+
+ChainBuffer::~ChainBuffer() {
+    RetrieveAll();
+}
+
+void ChainBuffer::Append(const char *data, size_t len) {
+    if (TailWritable()) {
+        Chunk &tail = chunks_.back();
+        size_t n = std::min(len, ChunkPool::kChunkSize - tail.write_index);
+        memcpy(tail.data + tail.write_index, data, n);
+        tail.write_index += n;
+        readable_ += n;
+        data += n;
+        len -= n;
+    }
+
+    ChunkPool &pool = ChunkPool::ThreadLocal();
+    while (len > 0) {
+        size_t n = std::min(len, ChunkPool::kChunkSize);
+        char *chunk = pool.Allocate();
+        memcpy(chunk, data, n);
+        PushChunk(chunk, n);
+        data += n;
+        len -= n;
+    }
+}
+
+void ChainBuffer::Append(const BlobPtr &blob, size_t offset) {
+    if (offset >= blob->size()) return;
+    size_t len = blob->size() - offset;
+    if (len < kMinBlobSegment) {
+        Append(blob->data() + offset, len);
+        return;
+    }
+    Chunk chunk = { const_cast<char*>(blob->data()), offset, blob->size(), blob };
+    chunks_.push_back(chunk);
+    readable_ += len;
+}
+
+void ChainBuffer::Retrieve(size_t len) {
+    while (len > 0 && !chunks_.empty()) {
+        Chunk &head = chunks_.front();
+        size_t n = std::min(len, head.write_index - head.read_index);
+        head.read_index += n;
+        readable_ -= n;
+        len -= n;
+        if (head.read_index == head.write_index) {
+            PopChunk();
+        }
+    }
+}
+
+void ChainBuffer::RetrieveAll() {
+    while (!chunks_.empty()) {
+        PopChunk();
+    }
+    readable_ = 0;
+}
+
+ssize_t ChainBuffer::ReadFd(int fd, int *saved_errno) {
+    ChunkPool &pool = ChunkPool::ThreadLocal();
+    struct iovec vec[kMaxReadChunks + 1];
+    char *fresh[kMaxReadChunks];
+    int iovcnt = 0;
+
+    // 先填满尾部内存块剩余空间, 再读入新的内存块
+    if (TailWritable() && chunks_.back().write_index < ChunkPool::kChunkSize) {
+        Chunk &tail = chunks_.back();
+        vec[iovcnt].iov_base = tail.data + tail.write_index;
+        vec[iovcnt].iov_len = ChunkPool::kChunkSize - tail.write_index;
+        ++iovcnt;
+    }
+    const int tail_vecs = iovcnt;
+    for (int i = 0; i < kMaxReadChunks; ++i) {
+        fresh[i] = pool.Allocate();
+        vec[iovcnt].iov_base = fresh[i];
+        vec[iovcnt].iov_len = ChunkPool::kChunkSize;
+        ++iovcnt;
+    }
+
+    const ssize_t n = readv(fd, vec, iovcnt);
+    if (n < 0) {
+        *saved_errno = errno;
+    }
+
+    size_t remaining = n > 0 ? static_cast<size_t>(n) : 0;
+    if (tail_vecs) {
+        size_t len = std::min(remaining, vec[0].iov_len);
+        chunks_.back().write_index += len;
+        readable_ += len;
+        remaining -= len;
+    }
+    for (int i = 0; i < kMaxReadChunks; ++i) {
+        if (remaining > 0) {
+            size_t len = std::min(remaining, ChunkPool::kChunkSize);
+            PushChunk(fresh[i], len);
+            remaining -= len;
+        } else {
+            pool.Deallocate(fresh[i]);
+        }
+    }
+
+    return n;
+}
+
+ssize_t ChainBuffer::WriteFd(int fd, int *saved_errno, size_t blob_limit) {
+    struct iovec vec[kMaxIovecs];
+    int iovcnt = 0;
+    for (auto it = chunks_.begin(); it != chunks_.end() && iovcnt < kMaxIovecs; ++it) {
+        size_t len = it->write_index - it->read_index;
+        if (blob_limit > 0 && it->blob && len >= blob_limit && iovcnt > 0) break;
+        vec[iovcnt].iov_base = it->data + it->read_index;
+        vec[iovcnt].iov_len = len;
+        ++iovcnt;
+    }
+
+    const ssize_t n = writev(fd, vec, iovcnt);
+    if (n < 0) {
+        *saved_errno = errno;
+    }
+    return n;
+}
+
+BlobPtr ChainBuffer::FrontBlob(size_t min_len, const char **data, size_t *len) const {
+    if (chunks_.empty() || !chunks_.front().blob) return BlobPtr();
+    const Chunk &head = chunks_.front();
+    if (head.write_index - head.read_index < min_len) return BlobPtr();
+    *data = head.data + head.read_index;
+    *len = head.write_index - head.read_index;
+    return head.blob;
+}
+
+void ChainBuffer::PushChunk(char *data, size_t write_index) {
+    Chunk chunk = { data, 0, write_index, BlobPtr() };
+    chunks_.push_back(chunk);
+    readable_ += write_index;
+}
+
+void ChainBuffer::PopChunk() {
+    Chunk &head = chunks_.front();
+    readable_ -= head.write_index - head.read_index;
+    if (!head.blob) {
+        ChunkPool::ThreadLocal().Deallocate(head.data);
+    }
+    chunks_.pop_front();
+}
+
+} // namespace net
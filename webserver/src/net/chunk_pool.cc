@@ -0,0 +1,37 @@
+#include "net/chunk_pool.h"
+
+namespace net {
+
+const size_t ChunkPool::kChunkSize;
+const size_t ChunkPool::kMaxCachedChunks;
+
+ChunkPool& ChunkPool::ThreadLocal() {
+    static thread_local ChunkPool pool;
+    return pool;
+}
+
+ChunkPool::~ChunkPool() {
+    for (char *chunk : free_chunks_) {
+        operator delete(chunk);
+    }
+}
+
+char* ChunkPool::Allocate() {
+    if (free_chunks_.empty()) {
+        return static_cast<char*>(operator new(kChunkSize));
+    }
+    char *chunk = free_chunks_.back();
+    free_chunks_.pop_back();
+    return chunk;
+}
+
+void ChunkPool::Deallocate(char *chunk) {
+    // 超过缓存上限的内存块直接归还系统, 空闲线程不会长期占用大量内存
+    if (free_chunks_.size() >= kMaxCachedChunks) {
+        operator delete(chunk);
+    } else {
+        free_chunks_.push_back(chunk);
+    }
+}
+
+} // namespace net
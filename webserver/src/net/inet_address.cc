@@ -1,21 +1,122 @@
 #include "net/inet_address.h"
+#include "log/logger.h"
 
+#include <stddef.h>
+#include <string.h>
 #include <strings.h>
 
 namespace net {
 
 InetAddress::InetAddress(uint16_t port, const std::string &ip) {
     bzero(&addr_, sizeof(addr_));
-    addr_.sin_family = AF_INET;
-    addr_.sin_port = htons(port);
-    addr_.sin_addr.s_addr = inet_addr(ip.c_str());
-    port_ = port;
-    ip_ = ip;
+    if (ip.find(':') != std::string::npos) {
+        addr_.v6.sin6_family = AF_INET6;
+        addr_.v6.sin6_port = htons(port);
+        if (::inet_pton(AF_INET6, ip.c_str(), &addr_.v6.sin6_addr) != 1) {
+            LOG_ERROR << "InetAddress: invalid IPv6 address " << ip;
+        }
+        len_ = sizeof(addr_.v6);
+    } else {
+        addr_.v4.sin_family = AF_INET;
+        addr_.v4.sin_port = htons(port);
+        addr_.v4.sin_addr.s_addr = inet_addr(ip.c_str());
+        len_ = sizeof(addr_.v4);
+    }
 }
 
-InetAddress::InetAddress(const sockaddr_in &addr) : addr_(addr) {
-    port_ = ntohs(addr_.sin_port);
-    ip_ = inet_ntoa(addr_.sin_addr);
+InetAddress::InetAddress(const sockaddr *addr, socklen_t len) {
+    SetSockAddr(addr, len);
+}
+
+InetAddress InetAddress::Unix(const std::string &path) {
+    InetAddress result;
+    bzero(&result.addr_, sizeof(result.addr_));
+    result.addr_.un.sun_family = AF_UNIX;
+    // 路径以 '\0' 结尾, 抽象命名空间的名字不需要, 长度按实际字节数计算
+    if (path.empty() || path.size() >= sizeof(result.addr_.un.sun_path)) {
+        LOG_FATAL << "InetAddress: invalid unix socket path " << path;
+    }
+    memcpy(result.addr_.un.sun_path, path.data(), path.size());
+    if (path[0] == '@') {
+        result.addr_.un.sun_path[0] = '\0';
+        result.len_ = static_cast<socklen_t>(offsetof(sockaddr_un, sun_path) + path.size());
+    } else {
+        result.len_ = static_cast<socklen_t>(offsetof(sockaddr_un, sun_path) + path.size() + 1);
+    }
+    return result;
+}
+
+void InetAddress::SetSockAddr(const sockaddr *addr, socklen_t len) {
+    if (len > sizeof(addr_)) len = sizeof(addr_);
+    bzero(&addr_, sizeof(addr_));
+    memcpy(&addr_, addr, len);
+    len_ = len;
+}
+
+bool InetAddress::IsAbstract() const {
+    return IsUnix() && len_ > offsetof(sockaddr_un, sun_path) && addr_.un.sun_path[0] == '\0';
+}
+
+std::string InetAddress::GetIp() const {
+    switch (family()) {
+        case AF_INET: {
+            char buf[INET_ADDRSTRLEN];
+            ::inet_ntop(AF_INET, &addr_.v4.sin_addr, buf, sizeof(buf));
+            return buf;
+        }
+        case AF_INET6: {
+            char buf[INET6_ADDRSTRLEN];
+            ::inet_ntop(AF_INET6, &addr_.v6.sin6_addr, buf, sizeof(buf));
+            return buf;
+        }
+        case AF_UNIX: {
+            // accept 得到的未命名客户端只有 sun_family
+            if (len_ <= offsetof(sockaddr_un, sun_path)) return std::string();
+            size_t n = len_ - offsetof(sockaddr_un, sun_path);
+            if (IsAbstract()) return "@" + std::string(addr_.un.sun_path + 1, n - 1);
+            return std::string(addr_.un.sun_path, strnlen(addr_.un.sun_path, n));
+        }
+        default:
+            return std::string();
+    }
+}
+
+uint16_t InetAddress::GetPort() const {
+    switch (family()) {
+        case AF_INET:
+            return ntohs(addr_.v4.sin_port);
+        case AF_INET6:
+            return ntohs(addr_.v6.sin6_port);
+        default:
+            return 0;
+    }
+}
+
+std::string InetAddress::GetIpPort() const {
+    switch (family()) {
+        case AF_INET:
+            return GetIp() + ":" + std::to_string(GetPort());
+        case AF_INET6:
+            return "[" + GetIp() + "]:" + std::to_string(GetPort());
+        case AF_UNIX:
+            return "unix:" + GetIp();
+        default:
+            return std::string();
+    }
+}
+
+uint32_t InetAddress::IpHash() const {
+    switch (family()) {
+        case AF_INET:
+            return addr_.v4.sin_addr.s_addr;
+        case AF_INET6: {
+            uint32_t words[4];
+            memcpy(words, &addr_.v6.sin6_addr, sizeof(words));
+            return words[0] ^ words[1] ^ words[2] ^ words[3];
+        }
+        default:
+            return 0;
+    }
 }
     
 } // namespace connection
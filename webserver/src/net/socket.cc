@@ -3,10 +3,30 @@
 #include "log/logger.h"
 
 #include <arpa/inet.h>
+#include <linux/filter.h>
 #include <netinet/tcp.h>
 #include <unistd.h>
 #include <strings.h>
 
+#ifndef SO_BUSY_POLL
+#define SO_BUSY_POLL 46
+#endif
+#ifndef SO_PREFER_BUSY_POLL
+#define SO_PREFER_BUSY_POLL 69
+#endif
+#ifndef SO_ZEROCOPY
+#define SO_ZEROCOPY 60
+#endif
+#ifndef SO_INCOMING_CPU
+#define SO_INCOMING_CPU 49
+#endif
+#ifndef TCP_NOTSENT_LOWAT
+#define TCP_NOTSENT_LOWAT 25
+#endif
+#ifndef SO_ATTACH_REUSEPORT_CBPF
+#define SO_ATTACH_REUSEPORT_CBPF 51
+#endif
+
 namespace net {
 
 Socket::~Socket() {
@@ -14,29 +34,26 @@ Socket::~Socket() {
 }
 
 void Socket::Bind(const InetAddress &addr) {
-    if (0 > ::bind(sockfd_,
-                   reinterpret_cast<const sockaddr*>(addr.GetSockAddr()),
-                   sizeof(sockaddr_in))) {
-        LOG_FATAL << "bind socket: " << sockfd_ << " error";
+    if (0 > ::bind(sockfd_, addr.GetSockAddr(), addr.GetSockLen())) {
+        LOG_FATAL << "bind socket: " << sockfd_ << " to " << addr.GetIpPort() << " error: " << errno;
     }
 }
 
-void Socket::Listen() {
-    if (0 > ::listen(sockfd_, SOMAXCONN)) {
+void Socket::Listen(int backlog) {
+    if (0 > ::listen(sockfd_, backlog)) {
         LOG_FATAL << "listen socket: " << sockfd_ << " error";
     }
 }
 
 int Socket::Accept(InetAddress *peer_addr) {
-    sockaddr_in addr;
+    sockaddr_storage addr;
     socklen_t len = sizeof(addr);
-    bzero(&addr, sizeof(addr));
 
     int connfd = ::accept4(sockfd_,
                            reinterpret_cast<sockaddr*>(&addr),
                            &len,
                            SOCK_NONBLOCK | SOCK_CLOEXEC);
-    if (connfd >= 0) peer_addr->SetSockAddr(addr);
+    if (connfd >= 0) peer_addr->SetSockAddr(reinterpret_cast<sockaddr*>(&addr), len);
     return connfd;
 }
 
@@ -73,6 +90,103 @@ void Socket::SetKeepAlive(bool on) {
         LOG_ERROR << "setsockopt SO_KEEPALIVE socket: " << sockfd_ << " error";
     }
 }
+
+bool Socket::SetDeferAccept(int seconds) {
+    if (0 > ::setsockopt(sockfd_, IPPROTO_TCP, TCP_DEFER_ACCEPT, &seconds, static_cast<socklen_t>(sizeof(seconds)))) {
+        LOG_ERROR << "setsockopt TCP_DEFER_ACCEPT socket: " << sockfd_ << " error: " << errno;
+        return false;
+    }
+    return true;
+}
+
+bool Socket::SetFastOpen(int queue_len) {
+    if (0 > ::setsockopt(sockfd_, IPPROTO_TCP, TCP_FASTOPEN, &queue_len, static_cast<socklen_t>(sizeof(queue_len)))) {
+        LOG_ERROR << "setsockopt TCP_FASTOPEN socket: " << sockfd_ << " error: " << errno;
+        return false;
+    }
+    return true;
+}
+
+bool Socket::SetRecvBuffer(int bytes) {
+    if (0 > ::setsockopt(sockfd_, SOL_SOCKET, SO_RCVBUF, &bytes, static_cast<socklen_t>(sizeof(bytes)))) {
+        LOG_ERROR << "setsockopt SO_RCVBUF socket: " << sockfd_ << " error: " << errno;
+        return false;
+    }
+    return true;
+}
+
+bool Socket::SetSendBuffer(int bytes) {
+    if (0 > ::setsockopt(sockfd_, SOL_SOCKET, SO_SNDBUF, &bytes, static_cast<socklen_t>(sizeof(bytes)))) {
+        LOG_ERROR << "setsockopt SO_SNDBUF socket: " << sockfd_ << " error: " << errno;
+        return false;
+    }
+    return true;
+}
+
+bool Socket::SetNotSentLowat(int bytes) {
+    if (0 > ::setsockopt(sockfd_, IPPROTO_TCP, TCP_NOTSENT_LOWAT, &bytes, static_cast<socklen_t>(sizeof(bytes)))) {
+        LOG_ERROR << "setsockopt TCP_NOTSENT_LOWAT socket: " << sockfd_ << " error: " << errno;
+        return false;
+    }
+    return true;
+}
+
+bool Socket::SetZeroCopy(bool on) {
+    int optval = on ? 1 : 0;
+    if (0 > ::setsockopt(sockfd_, SOL_SOCKET, SO_ZEROCOPY, &optval, static_cast<socklen_t>(sizeof(optval)))) {
+        LOG_ERROR << "setsockopt SO_ZEROCOPY socket: " << sockfd_ << " error: " << errno;
+        return false;
+    }
+    return true;
+}
+
+bool Socket::SetBusyPoll(int usec) {
+    if (0 > ::setsockopt(sockfd_, SOL_SOCKET, SO_BUSY_POLL, &usec, static_cast<socklen_t>(sizeof(usec)))) {
+        LOG_ERROR << "setsockopt SO_BUSY_POLL socket: " << sockfd_ << " error: " << errno;
+        return false;
+    }
+    return true;
+}
+
+bool Socket::SetPreferBusyPoll(bool on) {
+    int optval = on ? 1 : 0;
+    if (0 > ::setsockopt(sockfd_, SOL_SOCKET, SO_PREFER_BUSY_POLL, &optval, static_cast<socklen_t>(sizeof(optval)))) {
+        LOG_ERROR << "setsockopt SO_PREFER_BUSY_POLL socket: " << sockfd_ << " error: " << errno;
+        return false;
+    }
+    return true;
+}
+
+bool Socket::SetIncomingCpu(int cpu) {
+    if (0 > ::setsockopt(sockfd_, SOL_SOCKET, SO_INCOMING_CPU, &cpu, static_cast<socklen_t>(sizeof(cpu)))) {
+        LOG_ERROR << "setsockopt SO_INCOMING_CPU socket: " << sockfd_ << " error: " << errno;
+        return false;
+    }
+    return true;
+}
+
+bool Socket::AttachReusePortCpuSteering(const std::vector<int> &cpus) {
+    if (cpus.empty()) return false;
+    // A = 收包 CPU; 逐个比较, 命中返回下标, 都不命中返回 A % n
+    std::vector<sock_filter> code;
+    code.push_back(sock_filter BPF_STMT(BPF_LD | BPF_W | BPF_ABS, static_cast<uint32_t>(SKF_AD_OFF + SKF_AD_CPU)));
+    for (size_t i = 0; i < cpus.size(); ++i) {
+        if (cpus[i] < 0) continue;
+        code.push_back(sock_filter BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, static_cast<uint32_t>(cpus[i]), 0, 1));
+        code.push_back(sock_filter BPF_STMT(BPF_RET | BPF_K, static_cast<uint32_t>(i)));
+    }
+    code.push_back(sock_filter BPF_STMT(BPF_ALU | BPF_MOD | BPF_K, static_cast<uint32_t>(cpus.size())));
+    code.push_back(sock_filter BPF_STMT(BPF_RET | BPF_A, 0));
+
+    sock_fprog prog;
+    prog.len = static_cast<unsigned short>(code.size());
+    prog.filter = code.data();
+    if (0 > ::setsockopt(sockfd_, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &prog, static_cast<socklen_t>(sizeof(prog)))) {
+        LOG_ERROR << "setsockopt SO_ATTACH_REUSEPORT_CBPF socket: " << sockfd_ << " error: " << errno;
+        return false;
+    }
+    return true;
+}
     
 } // namespace connection
 
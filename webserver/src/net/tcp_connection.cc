@@ -4,76 +4,252 @@
 #include "event/event_loop.h"
 #include "log/logger.h"
 
+#include <algorithm>
+#include <errno.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <linux/errqueue.h>
+
+#ifndef MSG_ZEROCOPY
+#define MSG_ZEROCOPY 0x4000000
+#endif
+#ifndef SO_EE_ORIGIN_ZEROCOPY
+#define SO_EE_ORIGIN_ZEROCOPY 5
+#endif
+#ifndef SO_EE_CODE_ZEROCOPY_COPIED
+#define SO_EE_CODE_ZEROCOPY_COPIED 1
+#endif
+
 namespace net {
 
+namespace {
+
+// 连接销毁时还没有收到完成通知的 blob 延后释放的秒数, 关闭前排队的数据内核可能仍在发送
+const double kZeroCopyLingerSeconds = 30;
+
+} // namespace
+
 TcpConnection::TcpConnection(event::EventLoop *loop,
                              int sockfd,
-                             const InetAddress &local_addr,
                              const InetAddress &peer_addr)
         : loop_(loop),
           state_(kConnecting),
           socket_(new Socket(sockfd)),
           channel_(new event::Channel(loop_, sockfd)),
-          local_addr_(local_addr),
-          peer_addr_(peer_addr) {
+          local_addr_(),
+          local_addr_resolved_(false),
+          peer_addr_(peer_addr),
+          high_water_mark_(kDefaultHighWaterMark),
+          low_water_mark_(kDefaultLowWaterMark),
+          reading_paused_(false),
+          peer_closed_(false),
+          flow_control_(),
+          accounted_output_(0),
+          cork_responses_(false),
+          zerocopy_threshold_(0),
+          zerocopy_next_seq_(0),
+          budget_bytes_(kDefaultBudgetBytes),
+          budget_requests_(kDefaultBudgetRequests),
+          requests_left_(kDefaultBudgetRequests),
+          read_pending_(false),
+          continue_scheduled_(false),
+          idle_timeout_(0),
+          header_read_timeout_(0),
+          reading_request_(false),
+          requests_(0),
+          timeout_entry_(std::bind(&TcpConnection::HandleTimeout, this)) {
     channel_->SetReadCallback(std::bind(&TcpConnection::HandleRead, this));
     channel_->SetWriteCallback(std::bind(&TcpConnection::HandleWrite, this));
     channel_->SetCloseCallback(std::bind(&TcpConnection::HandleClose, this));
     channel_->SetErrorCallback(std::bind(&TcpConnection::HandleError, this));
-    socket_->SetKeepAlive(true);
+    if (!peer_addr_.IsUnix()) socket_->SetKeepAlive(true);
 
-    LOG_INFO << "TcpConnection::ctor[" << local_addr_.GetIpPort() << "] at " << channel_->fd();
+    LOG_DEBUG << "TcpConnection::ctor[" << peer_addr_.GetIpPort() << "] at " << channel_->fd();
 }
 
 TcpConnection::~TcpConnection() {}
 
+const InetAddress& TcpConnection::local_addr() const {
+    if (!local_addr_resolved_) {
+        sockaddr_storage local;
+        bzero(&local, sizeof(local));
+        socklen_t len = static_cast<socklen_t>(sizeof(local));
+        if (::getsockname(channel_->fd(), reinterpret_cast<sockaddr*>(&local), &len) < 0) {
+            LOG_ERROR << "TcpConnection::local_addr getsockname error: " << errno;
+        }
+        local_addr_.SetSockAddr(reinterpret_cast<sockaddr*>(&local), len);
+        local_addr_resolved_ = true;
+    }
+    return local_addr_;
+}
+
+void TcpConnection::SetSocketOptions(const SocketOptions &options) {
+    cork_responses_ = options.cork_responses;
+    // Unix 域套接字没有 TCP 层的选项
+    if (peer_addr_.IsUnix()) return;
+    if (options.tcp_nodelay) socket_->SetTcpNoDelay(true);
+    if (options.notsent_lowat > 0) socket_->SetNotSentLowat(options.notsent_lowat);
+    if (options.zerocopy_threshold > 0 && socket_->SetZeroCopy(true)) {
+        zerocopy_threshold_ = options.zerocopy_threshold;
+    }
+}
+
+void TcpConnection::SetTcpNoDelay(bool on) {
+    socket_->SetTcpNoDelay(on);
+}
+
+bool TcpConnection::SetBusyPoll(int usec) {
+    return socket_->SetBusyPoll(usec) && socket_->SetPreferBusyPoll(true);
+}
+
 void TcpConnection::HandleRead() {
+    const bool edge_triggered = channel_->IsEdgeTriggered();
     int saved_errno = 0;
-    ssize_t n = input_buffer_.ReadFd(channel_->fd(), &saved_errno);
-    if (n > 0) {
+    ssize_t n = 0;
+    size_t total = 0;
+    read_pending_ = false;
+    // 已经排在就绪列表里时本轮的请求预算不重置, 剩下的请求等轮到它时再处理
+    if (!continue_scheduled_) requests_left_ = budget_requests_;
+    // 水平触发每次只读一次; 边缘触发读到 EAGAIN 为止, 超过预算后让出给其他连接
+    do {
+        n = input_buffer_.ReadFd(channel_->fd(), &saved_errno);
+        if (n > 0) total += n;
+    } while (edge_triggered && n > 0 && (budget_bytes_ == 0 || total < budget_bytes_));
+
+    // 上一轮因请求预算留下的请求也在这里继续处理, 读到 EOF 时同样先处理完已收到的请求
+    if (total > 0 || (input_buffer_.ReadableBytes() > 0 && Connected())) {
         message_callback_(shared_from_this(), &input_buffer_);
-    } else if (n == 0) {
-        HandleClose();
-    } else {
-        errno = saved_errno;
-        LOG_ERROR << "TcpConnection::HandleRead";
-        HandleError();
+        input_buffer_.ShrinkIfIdle();
+        RefreshTimeout();
+    }
+
+    if (n == 0) {
+        // 对端可能只关闭了写端, 还在等排队的响应, 不能立即关闭连接
+        peer_closed_ = true;
+        if (channel_->IsReading()) channel_->DisableReading();
+        CloseIfDrained();
+    } else if (n < 0) {
+        if (saved_errno != EAGAIN && saved_errno != EWOULDBLOCK) {
+            errno = saved_errno;
+            LOG_ERROR << "TcpConnection::HandleRead";
+            HandleError();
+        }
+    } else if (edge_triggered) {
+        // 预算用完但还有数据, 边缘触发不会再通知, 下一轮继续读
+        read_pending_ = true;
+        ScheduleContinue();
     }
 }
 
 void TcpConnection::HandleWrite() {
+    if (!channel_->IsWriting()) {
+        LOG_ERROR << "Connection is down, no more writing";
+        return;
+    }
+    // 边缘触发时可写事件常驻, 没有待写数据时的通知直接忽略
+    if (output_buffer_.ReadableBytes() == 0) return;
+
+    const bool edge_triggered = channel_->IsEdgeTriggered();
     int saved_errno = 0;
-    if (channel_->IsWriting()) {
-        ssize_t n = output_buffer_.WriteFd(channel_->fd(), &saved_errno);
+    ssize_t n = 0;
+    size_t total = 0;
+    do {
+        // 头部是大 blob 时单独用 MSG_ZEROCOPY 发送, 其余数据仍由 writev 拷贝
+        const char *data = nullptr;
+        size_t len = 0;
+        BlobPtr blob;
+        if (zerocopy_threshold_ > 0) blob = output_buffer_.FrontBlob(zerocopy_threshold_, &data, &len);
+        if (blob) {
+            n = SendZeroCopy(data, len, 0, blob);
+            if (n < 0) saved_errno = errno;
+        } else {
+            n = output_buffer_.WriteFd(channel_->fd(), &saved_errno, zerocopy_threshold_);
+        }
         if (n > 0) {
+            total += n;
             output_buffer_.Retrieve(n);
-            if (output_buffer_.ReadableBytes() == 0) {
-                channel_->DisableWriting();
-                if (write_complete_callback_) {
-                    loop_->RunInLoop(std::bind(write_complete_callback_, shared_from_this()));
-                }
-                if (state_ == kDisconnecting) {
-                    ShutdownInLoop();
-                }
-            }
-        } else {
+        }
+    } while (edge_triggered && n > 0 && output_buffer_.ReadableBytes() > 0
+             && (budget_bytes_ == 0 || total < budget_bytes_));
+
+    if (total > 0) {
+        RefreshTimeout();
+        UpdateFlowControl();
+    }
+
+    if (output_buffer_.ReadableBytes() == 0) {
+        if (!edge_triggered) channel_->DisableWriting();
+        if (write_complete_callback_) {
+            loop_->RunInLoop(std::bind(write_complete_callback_, shared_from_this()));
+        }
+        if (state_ == kDisconnecting) {
+            ShutdownInLoop();
+        }
+        CloseIfDrained();
+    } else if (n < 0) {
+        if (saved_errno != EAGAIN && saved_errno != EWOULDBLOCK) {
             LOG_ERROR << "TcpConnection::HandleWrite";
         }
-    } else {
-        LOG_ERROR << "Connection is down, no more writing";
+    } else if (edge_triggered && n > 0) {
+        QueueWrite();
+    }
+}
+
+bool TcpConnection::ConsumeRequestBudget() {
+    if (budget_requests_ == 0) return true;
+    if (requests_left_ > 0) {
+        --requests_left_;
+        return true;
+    }
+    ScheduleContinue();
+    return false;
+}
+
+void TcpConnection::ScheduleContinue() {
+    if (continue_scheduled_) return;
+    continue_scheduled_ = true;
+    TcpConnectionPtr guard_this(shared_from_this());
+    loop_->QueueReady([guard_this]() { guard_this->Continue(); });
+}
+
+void TcpConnection::Continue() {
+    continue_scheduled_ = false;
+    // 暂停读取期间由 ResumeReading 负责继续
+    if (Disconnected() || reading_paused_) return;
+    if (read_pending_) {
+        HandleRead();
+    } else if (Connected() && input_buffer_.ReadableBytes() > 0) {
+        requests_left_ = budget_requests_;
+        message_callback_(shared_from_this(), &input_buffer_);
+        input_buffer_.ShrinkIfIdle();
+        RefreshTimeout();
     }
+    CloseIfDrained();
+}
+
+void TcpConnection::QueueWrite() {
+    TcpConnectionPtr guard_this(shared_from_this());
+    loop_->QueueReady([guard_this]() {
+        if (!guard_this->Disconnected()) {
+            guard_this->HandleWrite();
+        }
+    });
 }
 
 void TcpConnection::HandleClose() {
-    LOG_INFO << "TcpConnection::HandleClose state = " << state_;
+    LOG_DEBUG << "TcpConnection::HandleClose state = " << state_;
     SetState(kDisconnected);
     channel_->DisableAll();
+    loop_->timing_wheel()->Cancel(&timeout_entry_);
     TcpConnectionPtr guard_this(shared_from_this());
     if (connection_callback_) connection_callback_(guard_this);
     if (close_callback_) close_callback_(guard_this);
 }
 
 void TcpConnection::HandleError() {
+    // MSG_ZEROCOPY 的完成通知也通过 EPOLLERR 报告, 只有通知而套接字没有错误时不记录
+    bool notified = HandleZeroCopyCompletions();
     int optval;
     socklen_t optlen = sizeof(optval);
     int err = 0;
@@ -82,16 +258,28 @@ void TcpConnection::HandleError() {
     } else {
         err = optval;
     }
-    LOG_ERROR << "TcpConnection::HandleError [" << local_addr_.GetIpPort()
+    if (err == 0 && notified) return;
+    LOG_ERROR << "TcpConnection::HandleError [" << local_addr().GetIpPort()
               << "] - SO_ERROR = " << err;
 }
 
 void TcpConnection::Send(const std::string &message) {
     if (state_ == kConnected) {
         if (loop_->is_in_loop_thread()) {
-            SendInLoop(message.c_str(), message.size());
+            SendInLoop(message.data(), message.size());
         } else {
-            loop_->QueueInLoop(std::bind(&TcpConnection::SendInLoop, this, message.c_str(), message.size()));
+            Send(std::string(message));
+        }
+    }
+}
+
+void TcpConnection::Send(std::string &&message) {
+    if (state_ == kConnected) {
+        if (loop_->is_in_loop_thread() && message.size() < ChainBuffer::kMinBlobSegment) {
+            SendInLoop(message.data(), message.size());
+        } else {
+            // 大块数据包装成 Blob, 没写完的部分直接被输出缓冲区引用
+            Send(std::make_shared<const Blob>(std::move(message)));
         }
     }
 }
@@ -102,9 +290,47 @@ void TcpConnection::Send(Buffer *buffer) {
             SendInLoop(buffer->Peek(), buffer->ReadableBytes());
             buffer->RetrieveAll();
         } else {
-            loop_->QueueInLoop([this, &buffer]() {
-                SendInLoop(buffer->Peek(), buffer->ReadableBytes());
-                buffer->RetrieveAll();
+            Send(std::move(*buffer));
+        }
+    }
+}
+
+void TcpConnection::Send(Buffer &&buffer) {
+    if (state_ == kConnected) {
+        if (loop_->is_in_loop_thread()) {
+            SendInLoop(buffer.Peek(), buffer.ReadableBytes());
+            buffer.RetrieveAll();
+        } else {
+            // 交换底层存储, 数据本身不拷贝
+            std::shared_ptr<Buffer> owned = std::make_shared<Buffer>(0);
+            owned->swap(buffer);
+            TcpConnectionPtr self = shared_from_this();
+            loop_->QueueInLoop([self, owned]() { self->SendInLoop(owned->Peek(), owned->ReadableBytes()); });
+        }
+    }
+}
+
+void TcpConnection::Send(const BlobPtr &blob) {
+    if (state_ == kConnected) {
+        if (loop_->is_in_loop_thread()) {
+            SendBlobInLoop(blob);
+        } else {
+            loop_->QueueInLoop(std::bind(&TcpConnection::SendBlobInLoop, shared_from_this(), blob));
+        }
+    }
+}
+
+void TcpConnection::Send(Buffer *header, const BlobPtr &body) {
+    if (state_ == kConnected) {
+        if (loop_->is_in_loop_thread()) {
+            SendWithBodyInLoop(header->Peek(), header->ReadableBytes(), body);
+            header->RetrieveAll();
+        } else {
+            std::shared_ptr<Buffer> owned = std::make_shared<Buffer>(0);
+            owned->swap(*header);
+            TcpConnectionPtr self = shared_from_this();
+            loop_->QueueInLoop([self, owned, body]() {
+                self->SendWithBodyInLoop(owned->Peek(), owned->ReadableBytes(), body);
             });
         }
     }
@@ -117,53 +343,235 @@ void TcpConnection::Shutdown() {
     }
 }
 
-void TcpConnection::SendInLoop(const void *data, size_t len) {
-    ssize_t n = 0;
-    size_t remaining = len;
-    bool fault_error = false;
+void TcpConnection::ForceClose() {
+    if (state_ == kConnected || state_ == kDisconnecting) {
+        SetState(kDisconnecting);
+        loop_->QueueInLoop(std::bind(&TcpConnection::ForceCloseInLoop, shared_from_this()));
+    }
+}
+
+void TcpConnection::ForceCloseInLoop() {
+    if (state_ == kConnected || state_ == kDisconnecting) {
+        HandleClose();
+    }
+}
+
+void TcpConnection::RefreshTimeout() {
+    if (state_ == kDisconnected) return;
+
+    event::TimingWheel *wheel = loop_->timing_wheel();
+    if (input_buffer_.ReadableBytes() > 0 && header_read_timeout_ > 0) {
+        // 请求头读取超时从第一个字节开始计时, 后续读写不延长, 防止慢速攻击
+        if (!reading_request_) {
+            reading_request_ = true;
+            wheel->Schedule(&timeout_entry_, header_read_timeout_);
+        }
+    } else {
+        reading_request_ = false;
+        if (idle_timeout_ > 0) {
+            wheel->Schedule(&timeout_entry_, idle_timeout_);
+        } else {
+            wheel->Cancel(&timeout_entry_);
+        }
+    }
+}
 
+void TcpConnection::HandleTimeout() {
+    LOG_INFO << "TcpConnection::HandleTimeout fd = " << channel_->fd()
+             << (reading_request_ ? " header read timeout" : " idle timeout");
+    TcpConnectionPtr guard_this(shared_from_this());
+    ForceCloseInLoop();
+}
+
+void TcpConnection::SendInLoop(const void *data, size_t len, bool more) {
     if (state_ == kDisconnected) {
         LOG_ERROR << "disconnected, give up writing";
         return;
     }
 
-    // 如果 output_buffer_ 没有数据, 尝试直接写
-    if (!channel_->IsWriting() && output_buffer_.ReadableBytes() == 0) {
-        n = ::write(channel_->fd(), data, len);
-        if (n >= 0) {
-            remaining = len - n;
-            if (remaining == 0 && write_complete_callback_) {
-                loop_->QueueInLoop(std::bind(write_complete_callback_, shared_from_this()));
+    ssize_t n = WriteDirect(data, len, more ? MSG_MORE : 0);
+    if (n < 0) return;
+    size_t remaining = len - n;
+    if (remaining > 0) {
+        PrepareQueue(remaining);
+        output_buffer_.Append(static_cast<const char*>(data) + n, remaining);
+        UpdateFlowControl();
+    }
+}
+
+void TcpConnection::SendBlobInLoop(const BlobPtr &blob) {
+    if (state_ == kDisconnected) {
+        LOG_ERROR << "disconnected, give up writing";
+        return;
+    }
+
+    const bool zerocopy = zerocopy_threshold_ > 0 && blob->size() >= zerocopy_threshold_;
+    ssize_t n = WriteDirect(blob->data(), blob->size(), 0, zerocopy ? &blob : nullptr);
+    if (n < 0) return;
+    size_t remaining = blob->size() - n;
+    if (remaining > 0) {
+        PrepareQueue(remaining);
+        // 没写完的部分引用 blob, 不拷贝
+        output_buffer_.Append(blob, n);
+        UpdateFlowControl();
+    }
+}
+
+void TcpConnection::SendWithBodyInLoop(const void *header, size_t len, const BlobPtr &body) {
+    // 头部带 MSG_MORE 时内核先不发出, 等 body 的第一次写一起组成报文;
+    // 头部没写完时剩下的部分和 body 一起进入输出缓冲区, 由 writev 合并发送
+    SendInLoop(header, len, cork_responses_ && body);
+    if (body) SendBlobInLoop(body);
+}
+
+ssize_t TcpConnection::WriteDirect(const void *data, size_t len, int flags, const BlobPtr *zerocopy_blob) {
+    // 输出缓冲区里还有数据时必须排在后面, 否则会乱序
+    if (output_buffer_.ReadableBytes() > 0) {
+        return 0;
+    }
+    ssize_t n = zerocopy_blob ? SendZeroCopy(data, len, flags, *zerocopy_blob)
+                              : ::send(channel_->fd(), data, len, flags);
+    if (n >= 0) {
+        if (static_cast<size_t>(n) == len && !(flags & MSG_MORE) && write_complete_callback_) {
+            loop_->QueueInLoop(std::bind(write_complete_callback_, shared_from_this()));
+        }
+        return n;
+    }
+    if (errno == EAGAIN) {
+        return 0;
+    }
+    LOG_ERROR << "TcpConnection::SendInLoop";
+    if (errno == EPIPE || errno == ECONNRESET) {
+        return -1;
+    }
+    return 0;
+}
+
+ssize_t TcpConnection::SendZeroCopy(const void *data, size_t len, int flags, const BlobPtr &blob) {
+    ssize_t n = ::send(channel_->fd(), data, len, flags | MSG_ZEROCOPY);
+    if (n >= 0) {
+        // 每次成功的 MSG_ZEROCOPY 发送占用一个序号, 内核完成后按序号区间通知, 在此之前 blob 不能释放
+        ZeroCopySend pending = { zerocopy_next_seq_++, blob };
+        zerocopy_pending_.push_back(pending);
+        return n;
+    }
+    // 超过 optmem 限制时这一次改为拷贝发送
+    if (errno == ENOBUFS) {
+        return ::send(channel_->fd(), data, len, flags);
+    }
+    return n;
+}
+
+bool TcpConnection::HandleZeroCopyCompletions() {
+    if (zerocopy_pending_.empty() && zerocopy_next_seq_ == 0) return false;
+
+    bool notified = false;
+    char control[256];
+    for (;;) {
+        msghdr msg;
+        bzero(&msg, sizeof(msg));
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        // 错误队列读空时返回 EAGAIN
+        if (::recvmsg(channel_->fd(), &msg, MSG_ERRQUEUE) < 0) break;
+
+        for (cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+            if (!(cmsg->cmsg_level == SOL_IP && cmsg->cmsg_type == IP_RECVERR)
+                    && !(cmsg->cmsg_level == SOL_IPV6 && cmsg->cmsg_type == IPV6_RECVERR)) {
+                continue;
             }
-        } else {
-            n = 0;
-            LOG_ERROR << "TcpConnection::SendInLoop";
-            if (errno == EPIPE || errno == ECONNRESET) {
-                fault_error = true;
+            const sock_extended_err *serr = reinterpret_cast<const sock_extended_err*>(CMSG_DATA(cmsg));
+            if (serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY || serr->ee_errno != 0) continue;
+            notified = true;
+
+            // [ee_info, ee_data] 内的发送都已完成, 序号是 32 位回绕的
+            const uint32_t first = serr->ee_info;
+            const uint32_t span = serr->ee_data - serr->ee_info;
+            zerocopy_pending_.erase(
+                std::remove_if(zerocopy_pending_.begin(), zerocopy_pending_.end(),
+                               [first, span](const ZeroCopySend &send) { return send.seq - first <= span; }),
+                zerocopy_pending_.end());
+
+            // 内核没能避免拷贝 (例如回环或网卡不支持分散聚集), 之后改回普通发送
+            if ((serr->ee_code & SO_EE_CODE_ZEROCOPY_COPIED) && zerocopy_threshold_ > 0) {
+                LOG_DEBUG << "TcpConnection::HandleZeroCopyCompletions fd = " << channel_->fd()
+                          << " kernel copied, fall back to copying sends";
+                zerocopy_threshold_ = 0;
             }
         }
     }
+    return notified;
+}
 
-    // 如果没有写完, 或者出现错误
-    if (remaining > 0 && !fault_error) {
-        size_t old_len = output_buffer_.ReadableBytes();
-        if (old_len + remaining > high_water_mark_
-                && old_len < high_water_mark_
-                && high_water_mark_callback_) {
-            loop_->QueueInLoop(std::bind(high_water_mark_callback_, shared_from_this(), old_len + remaining));
-        }
-        // 将剩余数据写入 output_buffer_
-        output_buffer_.Append(static_cast<const char*>(data) + n, remaining);
-        // 如果没有注册写事件, 则注册写事件
-        if (!channel_->IsWriting()) {
-            channel_->EnableWriting();
+void TcpConnection::PrepareQueue(size_t remaining) {
+    size_t old_len = output_buffer_.ReadableBytes();
+    if (old_len + remaining > high_water_mark_
+            && old_len < high_water_mark_
+            && high_water_mark_callback_) {
+        loop_->QueueInLoop(std::bind(high_water_mark_callback_, shared_from_this(), old_len + remaining));
+    }
+    // 如果没有注册写事件, 则注册写事件
+    if (!channel_->IsWriting()) {
+        channel_->EnableWriting();
+    }
+}
+
+void TcpConnection::UpdateFlowControl() {
+    size_t queued = output_buffer_.ReadableBytes();
+    if (flow_control_ && queued != accounted_output_) {
+        if (queued > accounted_output_) {
+            flow_control_->output_bytes.fetch_add(queued - accounted_output_, std::memory_order_relaxed);
+        } else {
+            flow_control_->output_bytes.fetch_sub(accounted_output_ - queued, std::memory_order_relaxed);
         }
+        accounted_output_ = queued;
+    }
+
+    // 超过服务端总量上限时只暂停还有输出的连接, 它们的写事件会负责恢复读取
+    bool over_limit = queued > 0 && flow_control_ && flow_control_->OverLimit();
+    if (!reading_paused_) {
+        if (queued > high_water_mark_ || over_limit) PauseReading();
+    } else if (queued <= low_water_mark_ && !over_limit) {
+        ResumeReading();
+    }
+}
+
+void TcpConnection::PauseReading() {
+    LOG_DEBUG << "TcpConnection::PauseReading fd = " << channel_->fd()
+              << " output = " << output_buffer_.ReadableBytes();
+    reading_paused_ = true;
+    if (flow_control_) {
+        ++flow_control_->paused_connections;
+        ++flow_control_->pause_events;
+    }
+    if (state_ != kDisconnected && channel_->IsReading()) {
+        channel_->DisableReading();
+    }
+}
+
+void TcpConnection::ResumeReading() {
+    LOG_DEBUG << "TcpConnection::ResumeReading fd = " << channel_->fd()
+              << " output = " << output_buffer_.ReadableBytes();
+    reading_paused_ = false;
+    if (flow_control_) --flow_control_->paused_connections;
+    if (state_ == kDisconnected) return;
+
+    // 重新注册读事件, 边缘触发下内核会重新报告已经就绪的数据 (包括暂停期间到达的 EOF)
+    if (!peer_closed_) channel_->EnableReading();
+    // 暂停期间已经读进输入缓冲区的请求不会再触发可读事件, 交给上层继续处理
+    if (input_buffer_.ReadableBytes() > 0) ScheduleContinue();
+}
+
+void TcpConnection::CloseIfDrained() {
+    if (peer_closed_ && state_ != kDisconnected && !continue_scheduled_
+            && output_buffer_.ReadableBytes() == 0) {
+        HandleClose();
     }
 }
 
 void TcpConnection::ShutdownInLoop() {
-    // 如果没有注册写事件, 则直接关闭写端
-    if (!channel_->IsWriting()) {
+    // 如果没有待写数据, 则直接关闭写端
+    if (output_buffer_.ReadableBytes() == 0) {
         // 关闭写端, 但是仍然可以读取数据
         socket_->ShutdownWrite();
     }
@@ -173,6 +581,8 @@ void TcpConnection::ConnectionEstablished() {
     SetState(kConnected);
     channel_->set_holder(shared_from_this());
     channel_->EnableReading();
+    if (channel_->IsEdgeTriggered()) channel_->EnableWriting();
+    RefreshTimeout();
     if (connection_callback_) connection_callback_(shared_from_this());
 }
 
@@ -182,7 +592,22 @@ void TcpConnection::ConnectionDestroyed() {
         channel_->DisableAll();
         if (connection_callback_) connection_callback_(shared_from_this());
     }
+    loop_->timing_wheel()->Cancel(&timeout_entry_);
+    if (flow_control_) {
+        flow_control_->output_bytes.fetch_sub(accounted_output_, std::memory_order_relaxed);
+        if (reading_paused_) --flow_control_->paused_connections;
+    }
+    accounted_output_ = 0;
+    reading_paused_ = false;
     channel_->Remove();
+
+    HandleZeroCopyCompletions();
+    if (!zerocopy_pending_.empty()) {
+        // 之后不会再收到完成通知, 延后释放, 避免内核发送时 blob 的内存已经被复用
+        std::shared_ptr<std::deque<ZeroCopySend>> pending = std::make_shared<std::deque<ZeroCopySend>>();
+        pending->swap(zerocopy_pending_);
+        loop_->RunAfter(kZeroCopyLingerSeconds, [pending]() {});
+    }
 }
     
 } // namespace connection
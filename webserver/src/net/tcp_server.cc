@@ -1,15 +1,10 @@
 #include "net/tcp_server.h"
 #include "log/logger.h"
 
-namespace net {
+#include <algorithm>
+#include <unistd.h>
 
-static int CreateSocket() {
-    int sockfd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_TCP);
-    if (sockfd < 0) {
-        LOG_FATAL << "CreateSocket";
-    }
-    return sockfd;
-}
+namespace net {
 
 TcpServer::TcpServer(event::EventLoop *loop,
                      const InetAddress &addr,
@@ -17,33 +12,58 @@ TcpServer::TcpServer(event::EventLoop *loop,
                      Option option)
         : loop_(loop),
           name_(name),
-          addr_(std::make_shared<InetAddress>(addr)),
-          accept_socket_(std::make_shared<Socket>(CreateSocket())),
-          accept_channel_(std::make_shared<event::Channel>(loop_, accept_socket_->fd())),
+          listen_addrs_(),
+          option_(option),
+          acceptors_(),
           thread_pool_(std::make_shared<event::EventLoopThreadPool>(loop_)),
           connection_callback_(),
           message_callback_(),
           started_(0),
+          idle_timeout_(0),
+          header_read_timeout_(0),
+          edge_triggered_(false),
+          socket_options_(),
+          budget_bytes_(TcpConnection::kDefaultBudgetBytes),
+          budget_requests_(TcpConnection::kDefaultBudgetRequests),
+          busy_poll_us_(0),
+          stats_log_interval_(0),
+          cpu_steering_(false),
+          max_connections_(0),
+          num_connections_(0),
+          rejected_connections_(0),
+          high_water_mark_(0),
+          low_water_mark_(0),
+          flow_control_(std::make_shared<FlowControl>()),
+          socket_busy_poll_(true),
           next_conn_id_(1) {
-    accept_socket_->SetReuseAddr(true);
-    accept_socket_->SetReusePort(option == kReusePort);
-    accept_socket_->Bind(*addr_);
-    accept_channel_->SetReadCallback(std::bind(&TcpServer::HandleNewConnection, this));
+    AddListenAddress(addr);
 }
 
 TcpServer::~TcpServer() {
-    accept_channel_->DisableAll();
-    accept_channel_->Remove();
-
-    for (auto &item: connection_map_) {
-        TcpConnectionPtr conn = item.second;
-        item.second.reset();
-        conn->GetLoop()->RunInLoop(
-            std::bind(&TcpConnection::ConnectionDestroyed, conn)
-        );
+    acceptors_.clear();
+    // 每个监听者只能在自己的 loop 线程中析构, 等它完成后才能释放 this
+    for (auto &acceptor : loop_acceptors_) {
+        Acceptor *raw = acceptor.release();
+        raw->GetLoop()->RunInLoopAndWait([raw]() { delete raw; });
+    }
+    // 在每个 loop 线程中关闭它的连接; 已投递的 DrainHandoff 排在前面, 会先执行完
+    for (auto &context : contexts_) {
+        LoopContext *raw = context.get();
+        raw->loop->RunInLoopAndWait(std::bind(&TcpServer::CloseAllInLoop, this, raw));
     }
 }
 
+void TcpServer::AddListenAddress(const InetAddress &addr) {
+    listen_addrs_.push_back(addr);
+    // 每个 loop 一个监听者的 TCP 地址在 Start 时创建, 其他地址现在就 bind, 地址冲突尽早暴露
+    if (option_ == kReusePortPerLoop && !addr.IsUnix()) return;
+    Acceptor *acceptor = new Acceptor(loop_, addr, option_ == kReusePort && !addr.IsUnix());
+    acceptor->SetNewConnectionCallback(
+        std::bind(&TcpServer::HandleNewConnection, this, std::placeholders::_1, std::placeholders::_2)
+    );
+    acceptors_.push_back(std::unique_ptr<Acceptor>(acceptor));
+}
+
 void TcpServer::SetThreadNum(int num_threads) {
     thread_pool_->SetThreadNum(num_threads);
 }
@@ -51,80 +71,201 @@ void TcpServer::SetThreadNum(int num_threads) {
 void TcpServer::Start() {
     if (started_++ == 0) {
         thread_pool_->Start(thread_init_callback_);
-        loop_->RunInLoop(
-            [this]() {
-                accept_socket_->Listen();
-                accept_channel_->EnableReading();
+        if (busy_poll_us_ > 0) {
+            for (event::EventLoop *loop : thread_pool_->GetAllLoops()) {
+                loop->SetBusyPoll(busy_poll_us_);
             }
-        );
+        }
+        if (stats_log_interval_ > 0) {
+            loop_->RunEvery(stats_log_interval_, std::bind(&TcpServer::LogLoopStats, this));
+        }
+        for (event::EventLoop *loop : thread_pool_->GetAllLoops()) {
+            contexts_.push_back(std::unique_ptr<LoopContext>(new LoopContext(loop, kHandoffCapacity)));
+            context_map_[loop] = contexts_.back().get();
+        }
+        if (option_ == kReusePortPerLoop) {
+            StartPerLoopAcceptors();
+        }
+        for (auto &acceptor : acceptors_) {
+            Acceptor *raw = acceptor.get();
+            raw->SetBatchDoneCallback(std::bind(&TcpServer::FlushHandoffs, this));
+            raw->SetSocketOptions(socket_options_);
+            loop_->RunInLoop([raw]() { raw->Listen(); });
+        }
     }
 }
 
-void TcpServer::HandleNewConnection() {
-    InetAddress peer_addr;
-    int connfd = accept_socket_->Accept(&peer_addr);
+void TcpServer::StartPerLoopAcceptors() {
+    std::vector<event::EventLoop*> loops = thread_pool_->GetAllLoops();
+    std::vector<int> cpus = thread_pool_->GetLoopCpus();
+
+    bool pinned = std::count(cpus.begin(), cpus.end(), -1) != static_cast<long>(cpus.size());
+    if (cpu_steering_ && !pinned) {
+        LOG_WARN << "TcpServer[" << name_ << "] cpu steering needs IO threads pinned to single cpus";
+    }
+
+    for (const InetAddress &addr : listen_addrs_) {
+        if (addr.IsUnix()) continue;
+        // 在当前线程中按顺序 bind + listen, 第 i 个监听者就是该地址 reuseport 组中的第 i 个套接字
+        size_t first = loop_acceptors_.size();
+        for (size_t i = 0; i < loops.size(); ++i) {
+            LoopContext *context = contexts_[i].get();
+            Acceptor *acceptor = new Acceptor(loops[i], addr, true);
+            acceptor->SetNewConnectionCallback(
+                [this, context](int connfd, const InetAddress &peer_addr) {
+                    if (AdmitConnection(context, connfd)) NewConnection(context, connfd, peer_addr);
+                }
+            );
+            if (cpu_steering_ && cpus[i] >= 0) acceptor->socket()->SetIncomingCpu(cpus[i]);
+            acceptor->SetSocketOptions(socket_options_);
+            loop_acceptors_.push_back(std::unique_ptr<Acceptor>(acceptor));
+            acceptor->Listen();
+        }
 
-    if (connfd < 0) {
-        LOG_FATAL << "Accept error: " << errno;
-        if (errno == EMFILE) {
-            LOG_FATAL << "Too many open files";
+        if (cpu_steering_ && pinned && loop_acceptors_[first]->socket()->AttachReusePortCpuSteering(cpus)) {
+            LOG_INFO << "TcpServer[" << name_ << "] reuseport cpu steering attached on " << addr.GetIpPort();
         }
+    }
+}
+
+void TcpServer::LogLoopStats() const {
+    std::vector<event::EventLoop*> loops = thread_pool_->GetAllLoops();
+    for (size_t i = 0; i < loops.size(); ++i) {
+        LOG_INFO << "TcpServer[" << name_ << "] loop " << i << ": connections=" << loops[i]->connection_count()
+                 << " " << loops[i]->stats().ToString();
+    }
+    LOG_INFO << "TcpServer[" << name_ << "] output_bytes=" << output_bytes()
+             << " paused_connections=" << paused_connections() << " pause_events=" << pause_events();
+}
+
+void TcpServer::HandleNewConnection(int connfd, const InetAddress &peer_addr) {
+    // 按负载均衡策略选择 EventLoop, 一致性哈希只使用对端 IP, 同一客户端的连接落在同一个 loop
+    // (Unix 域套接字的对端没有 IP, 一致性哈希下都落在同一个 loop)
+    event::EventLoop *loop = thread_pool_->GetNextLoop(peer_addr.IpHash());
+    LoopContext *context = context_map_[loop];
+    if (!AdmitConnection(context, connfd)) return;
+
+    // 没有 IO 线程时连接就在 acceptor 所在的 loop 上
+    if (loop == loop_) {
+        NewConnection(context, connfd, peer_addr);
         return;
     }
+    // 只传递 fd 和对端地址, 批次结束时由 FlushHandoffs 统一唤醒
+    PendingConnection pending = { connfd, peer_addr };
+    if (context->handoff.Push(pending)) {
+        context->dirty = true;
+    } else {
+        // 队列已满 (IO 线程严重滞后), 退回逐个投递
+        loop->QueueInLoop([this, context, pending]() { NewConnection(context, pending.fd, pending.peer_addr); });
+    }
+}
 
-    // 获取下一个EventLoop (轮询)
-    event::EventLoop *loop = thread_pool_->GetNextLoop();
-    std::string conn_name = name_ + "-" + std::to_string(next_conn_id_++);
-    LOG_INFO << "TcpServer::HandleNewConnection [" << name_
-             << "] - new connection [" << conn_name
-             << "] from " << peer_addr.GetIpPort();
-
-    // 获取本地地址
-    struct sockaddr_in local;
-    bzero(&local, sizeof(local));
-    socklen_t addrLen = static_cast<socklen_t>(sizeof(local));
-    if (::getsockname(connfd, reinterpret_cast<sockaddr*>(&local), &addrLen) < 0) {
-        LOG_ERROR << "TcpServer::HandleNewConnection getLocalAddr";
+void TcpServer::FlushHandoffs() {
+    for (auto &context : contexts_) {
+        if (!context->dirty) continue;
+        context->dirty = false;
+        // IO 线程还没开始处理上一次投递时, 新连接会被同一次 DrainHandoff 取走, 不需要再唤醒
+        if (!context->drain_scheduled.exchange(true)) {
+            context->loop->QueueInLoop(std::bind(&TcpServer::DrainHandoff, this, context.get()));
+        }
     }
-    InetAddress local_addr(local);
+}
 
-    // 创建TcpConnection
+void TcpServer::DrainHandoff(LoopContext *context) {
+    // 先清除标记再取: 之后入队的连接要么在这里被取走, 要么触发新的一次投递
+    // 用 exchange 与生产者的 exchange 同步, 保证能看到标记之前入队的元素
+    context->drain_scheduled.exchange(false);
+    PendingConnection pending;
+    while (context->handoff.Pop(&pending)) {
+        NewConnection(context, pending.fd, pending.peer_addr);
+    }
+}
+
+bool TcpServer::AdmitConnection(LoopContext *context, int connfd) {
+    // kReusePortPerLoop 时每个 loop 上的监听者各自检查, 并发时可能略微超过上限
+    if (max_connections_ > 0 && num_connections_.load(std::memory_order_relaxed) >= max_connections_) {
+        RejectConnection(connfd);
+        return false;
+    }
+    ++num_connections_;
+    // 在 acceptor 线程中立即计数, 负载均衡策略才能看到还在交接队列里的连接
+    context->loop->IncrementConnections();
+    return true;
+}
+
+void TcpServer::RejectConnection(int connfd) {
+    ::close(connfd);
+    // 过载时每个被拒绝的连接都写日志只会让情况更糟, 只记录第一个和之后每 1024 个
+    uint64_t rejected = ++rejected_connections_;
+    if ((rejected & 1023) == 1) {
+        LOG_WARN << "TcpServer[" << name_ << "] reached max connections " << max_connections_
+                 << ", rejected " << rejected << " connections so far";
+    }
+}
+
+// 在 loop 线程中调用, 连接相关的对象都由所属 IO 线程分配
+void TcpServer::NewConnection(LoopContext *context, int connfd, const InetAddress &peer_addr) {
+    int conn_id = next_conn_id_++;
+    LOG_DEBUG << "TcpServer::NewConnection [" << name_ << "] - new connection [" << name_ << "-" << conn_id
+              << "] from " << peer_addr.GetIpPort();
+
+    // 本地地址在需要时由 TcpConnection 通过 getsockname 获取
     TcpConnectionPtr conn(
         std::make_shared<TcpConnection>(
-            loop, connfd, local_addr, peer_addr
+            context->loop, connfd, peer_addr
         )
     );
-    connection_map_[connfd] = conn;
+    context->connections[connfd] = conn;
 
     conn->SetConnectionCallback(connection_callback_);
     conn->SetMessageCallback(message_callback_);
     conn->SetWriteCompleteCallback(write_complete_callback_);
+    conn->SetIdleTimeout(idle_timeout_);
+    conn->SetHeaderReadTimeout(header_read_timeout_);
+    conn->SetEdgeTriggered(edge_triggered_);
+    conn->SetSocketOptions(socket_options_);
+    conn->SetIoBudget(budget_bytes_, budget_requests_);
+    if (high_water_mark_ > 0) conn->SetWaterMarks(high_water_mark_, low_water_mark_);
+    conn->SetFlowControl(flow_control_);
+    if (busy_poll_us_ > 0 && socket_busy_poll_ && !conn->SetBusyPoll(busy_poll_us_)) {
+        LOG_WARN << "SO_BUSY_POLL not permitted, only busy polling in user space";
+        socket_busy_poll_ = false;
+    }
 
     conn->SetCloseCallback(
-        std::bind(&TcpServer::RemoveConnection, this, std::placeholders::_1)
-    );
-    LOG_INFO << "Connection established";
-    loop->RunInLoop(
-        std::bind(&TcpConnection::ConnectionEstablished, conn)
-    );
-}
-
-void TcpServer::RemoveConnection(const TcpConnectionPtr &conn) {
-    loop_->RunInLoop(
-        std::bind(&TcpServer::RemoveConnectionInLoop, this, conn)
+        std::bind(&TcpServer::RemoveConnection, this, context, std::placeholders::_1)
     );
+    conn->ConnectionEstablished();
 }
 
-void TcpServer::RemoveConnectionInLoop(const TcpConnectionPtr &conn) {
-    LOG_INFO << "TcpServer::RemoveConnection [" << name_
-             << "] - connection [" << conn->fd()
-             << "] from " << conn->peer_addr().GetIpPort();
+// 在连接所属的 loop 线程中调用
+void TcpServer::RemoveConnection(LoopContext *context, const TcpConnectionPtr &conn) {
+    LOG_DEBUG << "TcpServer::RemoveConnection [" << name_
+              << "] - connection [" << conn->fd()
+              << "] from " << conn->peer_addr().GetIpPort();
 
-    connection_map_.erase(conn->fd());
-    event::EventLoop *loop = conn->GetLoop();
-    loop->QueueInLoop(
+    context->connections.erase(conn->fd());
+    --num_connections_;
+    context->loop->DecrementConnections();
+    context->loop->QueueInLoop(
         std::bind(&TcpConnection::ConnectionDestroyed, conn)
     );
 }
 
+void TcpServer::CloseAllInLoop(LoopContext *context) {
+    PendingConnection pending;
+    while (context->handoff.Pop(&pending)) {
+        ::close(pending.fd);
+        --num_connections_;
+        context->loop->DecrementConnections();
+    }
+    for (auto &item : context->connections) {
+        TcpConnectionPtr conn = item.second;
+        --num_connections_;
+        context->loop->DecrementConnections();
+        conn->ConnectionDestroyed();
+    }
+    context->connections.clear();
+}
+
 } // namespace net
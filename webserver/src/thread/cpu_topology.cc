@@ -0,0 +1,113 @@
+#include "thread/cpu_topology.h"
+
+#include <dirent.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <map>
+#include <set>
+#include <utility>
+
+namespace thread {
+
+namespace {
+
+int ReadSysfsInt(int cpu, const char *file, int default_value) {
+    char path[128];
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/%s", cpu, file);
+    FILE *fp = ::fopen(path, "r");
+    if (fp == nullptr) return default_value;
+    int value = default_value;
+    if (fscanf(fp, "%d", &value) != 1) value = default_value;
+    ::fclose(fp);
+    return value;
+}
+
+// cpuN 目录下有一个指向所属节点的 nodeM 链接
+int ReadNumaNode(int cpu) {
+    char path[64];
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d", cpu);
+    DIR *dir = ::opendir(path);
+    if (dir == nullptr) return 0;
+    int node = 0;
+    while (dirent *entry = ::readdir(dir)) {
+        if (strncmp(entry->d_name, "node", 4) == 0 && entry->d_name[4] >= '0' && entry->d_name[4] <= '9') {
+            node = atoi(entry->d_name + 4);
+            break;
+        }
+    }
+    ::closedir(dir);
+    return node;
+}
+
+} // namespace
+
+std::vector<CpuInfo> GetCpuTopology() {
+    std::vector<CpuInfo> cpus;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (::sched_getaffinity(0, sizeof(set), &set) < 0) {
+        return cpus;
+    }
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (!CPU_ISSET(cpu, &set)) continue;
+        CpuInfo info;
+        info.cpu = cpu;
+        info.core = ReadSysfsInt(cpu, "core_id", cpu);
+        info.package = ReadSysfsInt(cpu, "physical_package_id", 0);
+        info.node = ReadNumaNode(cpu);
+        cpus.push_back(info);
+    }
+    return cpus;
+}
+
+int PhysicalCoreCount() {
+    std::set<std::pair<int, int>> cores;
+    for (const CpuInfo &info : GetCpuTopology()) {
+        cores.insert(std::make_pair(info.package, info.core));
+    }
+    return cores.empty() ? 1 : static_cast<int>(cores.size());
+}
+
+std::vector<int> SpreadCpus(int exclude_cpu) {
+    std::vector<CpuInfo> topology = GetCpuTopology();
+
+    std::pair<int, int> excluded(-1, -1);
+    for (const CpuInfo &info : topology) {
+        if (info.cpu == exclude_cpu) excluded = std::make_pair(info.package, info.core);
+    }
+
+    // 每个节点上各物理核的第一个逻辑 CPU, 超线程兄弟不再重复使用
+    std::map<int, std::vector<int>> node_cpus;
+    std::set<std::pair<int, int>> seen;
+    size_t total = 0;
+    for (const CpuInfo &info : topology) {
+        std::pair<int, int> core(info.package, info.core);
+        if (core == excluded || !seen.insert(core).second) continue;
+        node_cpus[info.node].push_back(info.cpu);
+        ++total;
+    }
+
+    std::vector<int> result;
+    for (size_t i = 0; result.size() < total; ++i) {
+        for (auto &item : node_cpus) {
+            if (i < item.second.size()) result.push_back(item.second[i]);
+        }
+    }
+    return result;
+}
+
+bool SetCurrentThreadAffinity(const std::vector<int> &cpus) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus) {
+        if (cpu >= 0 && cpu < CPU_SETSIZE) CPU_SET(cpu, &set);
+    }
+    if (CPU_COUNT(&set) == 0) return false;
+    return ::pthread_setaffinity_np(::pthread_self(), sizeof(set), &set) == 0;
+}
+
+} // namespace thread
@@ -1,4 +1,5 @@
 #include "thread/thread.h"
+#include "thread/cpu_topology.h"
 
 #include <semaphore.h>
 
@@ -17,6 +18,8 @@ Thread::Thread(const ThreadFunc &func, const std::string &name)
         : thread_id_(0),
           func_(func),
           name_(name),
+          cpus_(),
+          affinity_applied_(false),
           is_started_(false),
           is_joined_(false) {
     int num = ++started_count_;
@@ -38,6 +41,9 @@ void Thread::Start() {
 
     thread_ = std::thread([&] {
         thread_id_ = std::this_thread::get_id();
+        if (!cpus_.empty()) {
+            affinity_applied_ = SetCurrentThreadAffinity(cpus_);
+        }
         sem_post(&sem);
         func_();
     });
@@ -0,0 +1,83 @@
+// HttpServer 回归测试, 失败时返回非 0
+// closed_before_send: 回调里关闭连接后响应发不出去, 线程局部的响应缓冲区不能残留这个响应,
+//                     同一个 IO 线程上下一个连接收到的响应必须逐字节一致
+
+#include "bench_util.h"
+#include "http/http_server.h"
+#include "event/event_loop.h"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <unistd.h>
+
+namespace {
+
+const uint16_t kPort = 15300;
+
+int g_failures = 0;
+
+void Expect(bool ok, const char *name) {
+    printf("%s %s\n", ok ? "ok    " : "FAILED", name);
+    if (!ok) ++g_failures;
+}
+
+// 读到对端关闭为止
+std::string ReadAll(int fd) {
+    std::string result;
+    char buf[4096];
+    ssize_t n;
+    while ((n = ::read(fd, buf, sizeof(buf))) > 0) {
+        result.append(buf, n);
+    }
+    return result;
+}
+
+std::string Request(const char *request) {
+    int fd = bench::Connect(net::InetAddress(kPort));
+    if (::write(fd, request, strlen(request)) < 0) perror("write");
+    std::string response = ReadAll(fd);
+    ::close(fd);
+    return response;
+}
+
+// 只有一个 loop, 所有连接都在同一个线程上处理, 共用同一个响应缓冲区
+pid_t StartServer() {
+    return bench::StartServer([]() {
+        event::EventLoop loop;
+        http::HttpServer server(&loop, net::InetAddress(kPort));
+        net::TcpConnectionPtr current;
+        server.SetConnectionCallback([&current](const net::TcpConnectionPtr &conn) {
+            current = conn->Connected() ? conn : net::TcpConnectionPtr();
+        });
+        server.SetHttpCallback([&current](const http::HttpRequestParser &req,
+                                          http::HttpResponse &resp, const std::string&) {
+            resp.SetStatusCode(http::HttpResponse::k200Ok);
+            resp.SetStatusMessage("OK");
+            if (req.path() == "/close") {
+                // 响应写入连接之前连接已经关闭
+                resp.SetBody("stale response");
+                current->ForceClose();
+            } else {
+                resp.SetBody("second");
+            }
+        });
+        server.Start();
+        loop.Loop();
+    });
+}
+
+} // namespace
+
+int main() {
+    pid_t pid = StartServer();
+
+    std::string first = Request("GET /close HTTP/1.1\r\n\r\n");
+    Expect(first.empty(), "closed_before_send: closed connection gets no response");
+    std::string second = Request("GET /second HTTP/1.1\r\nConnection: close\r\n\r\n");
+    Expect(second == "HTTP/1.1 200 OK\r\nConnection: close\r\nContent-Length: 6\r\n\r\nsecond",
+           "closed_before_send: next response is byte-exact");
+
+    bench::StopServer(pid);
+    return g_failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,97 @@
+// TcpConnection 回归测试, 失败时返回非 0
+// half_close_while_paused: 客户端一次发出多个请求后关闭写端, 此时服务端因输出超过高水位暂停读取;
+//                          已收到的请求都要处理完, 排队的响应全部发出后服务端才关闭连接
+// 水平触发和边缘触发各测一次; 每个请求是 1 字节, 响应是 kBodySize 字节
+
+#include "bench_util.h"
+#include "net/tcp_server.h"
+#include "event/event_loop.h"
+
+#include <cstdio>
+#include <string>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+namespace {
+
+const uint16_t kPort = 15310;
+const size_t kRequests = 40;
+const size_t kBodySize = 64 * 1024;
+// 远小于全部响应的大小, 内核缓冲区装不下时输出积压在连接里, 超过高水位后暂停读取
+const int kSocketBuffer = 32 * 1024;
+
+int g_failures = 0;
+
+void Expect(bool ok, const char *name, const char *mode) {
+    printf("%s %s (%s)\n", ok ? "ok    " : "FAILED", name, mode);
+    if (!ok) ++g_failures;
+}
+
+pid_t StartServer(uint16_t port, bool edge_triggered) {
+    return bench::StartServer([=]() {
+        event::EventLoop loop;
+        net::TcpServer server(&loop, net::InetAddress(port), "test");
+        net::SocketOptions options;
+        options.send_buffer = kSocketBuffer;
+        server.SetSocketOptions(options);
+        server.SetEdgeTriggered(edge_triggered);
+        server.SetWaterMarks(2 * kBodySize, kBodySize / 2);
+        server.SetMessageCallback([](const net::TcpConnectionPtr &conn, net::Buffer *buf) {
+            // 和 HttpServer 一样, 连接暂停读取后不再处理剩下的请求
+            while (buf->ReadableBytes() > 0 && conn->Connected() && !conn->reading_paused()) {
+                buf->Retrieve(1);
+                conn->Send(bench::Body(kBodySize));
+            }
+        });
+        server.Start();
+        loop.Loop();
+    });
+}
+
+void HalfCloseWhilePaused(const char *mode, uint16_t port, bool edge_triggered) {
+    pid_t pid = StartServer(port, edge_triggered);
+
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    ::setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &kSocketBuffer, sizeof(kSocketBuffer));
+    // 服务端没有关闭连接时不会一直等下去
+    timeval timeout = { 5, 0 };
+    ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    net::InetAddress addr(port);
+    if (::connect(fd, addr.GetSockAddr(), addr.GetSockLen()) < 0) {
+        perror("connect");
+        exit(1);
+    }
+
+    std::string requests(kRequests, 'x');
+    if (::write(fd, requests.data(), requests.size()) < 0) perror("write");
+    ::shutdown(fd, SHUT_WR);
+    // 先不读, 让服务端的输出积压到暂停读取, 然后对端关闭在暂停期间到达
+    usleep(200 * 1000);
+
+    size_t received = 0;
+    bool closed = false;
+    char buf[64 * 1024];
+    for (;;) {
+        ssize_t n = ::read(fd, buf, sizeof(buf));
+        if (n > 0) {
+            received += n;
+        } else {
+            closed = n == 0;
+            break;
+        }
+    }
+    ::close(fd);
+    bench::StopServer(pid);
+
+    Expect(received == kRequests * kBodySize, "half_close_while_paused: every queued response is delivered", mode);
+    Expect(closed, "half_close_while_paused: server closes after the last response", mode);
+}
+
+} // namespace
+
+int main() {
+    HalfCloseWhilePaused("lt", kPort, false);
+    HalfCloseWhilePaused("et", kPort + 1, true);
+    return g_failures == 0 ? 0 : 1;
+}